@@ -0,0 +1,365 @@
+/*
+Copyright (C) 2021 Brian Barnes
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "fft_backend.h"
+#include "kiss_fft.h"
+#include "kiss_fftr.h"
+#include "simd.h"
+#include <cmath>
+#ifdef FFT_POCKETFFT
+#include "pocketfft_hdronly.h"
+#endif
+#ifdef FFT_FFTW
+#include <fftw3.h>
+#endif
+using namespace std;
+
+// kiss_fft (always available)
+template<class T>
+class kiss_backend: public fft_backend<T> {
+public:
+	kiss_backend(unsigned N): N(N), fwd(kiss_fft_alloc<T>(N,0,0,0)), inv(kiss_fftr_alloc<T>(N,1,0,0)) { }
+	~kiss_backend() { delete[] (char*)fwd; delete[] (char*)inv; }
+	void forward(const complex<T> *in, complex<T> *out) { kiss_fft(fwd,(const kiss_fft_cpx<T>*)in,(kiss_fft_cpx<T>*)out); }
+	void inverse(const complex<T> *in, T *out) {
+		// (with scratch space per thread rather than the one in the config)
+		static thread_local vector<kiss_fft_cpx<T> > tmp;
+		if (tmp.size() < N/2)
+			tmp.resize(N/2);
+		kiss_fftri(inv,(const kiss_fft_cpx<T>*)in,out,&tmp[0]);
+	}
+	const char *name() { return "kiss"; }
+private:
+	unsigned N;
+	kiss_fft_cfg<T> fwd;
+	kiss_fftr_cfg<T> inv;
+};
+
+// Power-of-two transforms specialized at compile time for the common block sizes: the recursion over the
+// sub-transforms is resolved by the compiler, the butterflies are radix-4 (with one radix-2 pass for odd
+// powers of two) and every pass has its own contiguous table of twiddle factors.
+template<class T, unsigned N, bool inverse>
+class pow2_fft {
+public:
+	pow2_fft(): rev(N) {
+		unsigned bits = 0;
+		while ((1u<<bits) < N)
+			bits++;
+		for (unsigned k=0; k<N; k++) {
+			unsigned r = 0;
+			for (unsigned b=0; b<bits; b++)
+				r |= ((k>>b)&1) << (bits-1-b);
+			rev[k] = r;
+		}
+		for (unsigned L=N, s=0; L>=4; L/=4, s++) {
+			// the passes are for L, L/4, L/16, ... down to 8 or 4
+			unsigned m = L/4;
+			tw[s].resize(6*m);
+			for (unsigned j=0; j<m; j++)
+				for (unsigned r=1; r<=3; r++) {
+					double phase = (inverse?2:-2)*pi*r*j/L;
+					tw[s][6*j+2*r-2] = (T)cos(phase);
+					tw[s][6*j+2*r-1] = (T)sin(phase);
+				}
+		}
+	}
+
+	// transform N interleaved complex values
+	void run(const T *in, T *out) {
+		for (unsigned k=0; k<N; k++) {
+			out[2*k] = in[2*rev[k]];
+			out[2*k+1] = in[2*rev[k]+1];
+		}
+		pass<N,0>(out);
+	}
+
+private:
+	static constexpr double pi = 3.141592653589793238462643383279502884197169399375105820974944592307816406286;
+
+	// transform the L values at d (in bit-reversed order); s is the index of this pass' twiddle table
+	template<unsigned L, unsigned s> inline void pass(T *d) {
+		if constexpr (L == 2) {
+			T r0 = d[0], i0 = d[1];
+			d[0] = r0 + d[2]; d[1] = i0 + d[3];
+			d[2] = r0 - d[2]; d[3] = i0 - d[3];
+		} else if constexpr (L >= 4) {
+			constexpr unsigned m = L/4;
+			// with bit-reversed input the quarters hold the transforms of x[4k], x[4k+2], x[4k+1], x[4k+3]
+			pass<m,s+1>(d); pass<m,s+1>(d+2*m); pass<m,s+1>(d+4*m); pass<m,s+1>(d+6*m);
+			const T *w = &tw[s][0];
+			T *q0 = d, *q1 = d+2*m, *q2 = d+4*m, *q3 = d+6*m;
+			for (unsigned j=0; j<2*m; j+=2, w+=6) {
+				T b0r = q0[j], b0i = q0[j+1];
+				T b1r = q2[j], b1i = q2[j+1];
+				T b2r = q1[j], b2i = q1[j+1];
+				T b3r = q3[j], b3i = q3[j+1];
+				if constexpr (m > 1) {
+					T r;
+					r = b1r*w[0] - b1i*w[1]; b1i = b1r*w[1] + b1i*w[0]; b1r = r;
+					r = b2r*w[2] - b2i*w[3]; b2i = b2r*w[3] + b2i*w[2]; b2r = r;
+					r = b3r*w[4] - b3i*w[5]; b3i = b3r*w[5] + b3i*w[4]; b3r = r;
+				}
+				T t0r = b0r + b2r, t0i = b0i + b2i;
+				T t1r = b0r - b2r, t1i = b0i - b2i;
+				T t2r = b1r + b3r, t2i = b1i + b3i;
+				T t3r = b1r - b3r, t3i = b1i - b3i;
+				q0[j] = t0r + t2r; q0[j+1] = t0i + t2i;
+				q2[j] = t0r - t2r; q2[j+1] = t0i - t2i;
+				if constexpr (inverse) {
+					// X1 = t1 + i*t3, X3 = t1 - i*t3
+					q1[j] = t1r - t3i; q1[j+1] = t1i + t3r;
+					q3[j] = t1r + t3i; q3[j+1] = t1i - t3r;
+				} else {
+					// X1 = t1 - i*t3, X3 = t1 + i*t3
+					q1[j] = t1r + t3i; q1[j+1] = t1i - t3r;
+					q3[j] = t1r - t3i; q3[j+1] = t1i + t3r;
+				}
+			}
+		}
+	}
+
+	std::vector<unsigned> rev;	// bit reversal permutation
+	std::vector<T> tw[16];		// twiddles w^j, w^2j, w^3j of each radix-4 pass (largest first)
+};
+
+template<class T, unsigned N>
+class pow2_backend: public fft_backend<T> {
+public:
+	pow2_backend(): super(N/2) {
+		// the real inverse transform runs as a complex one of half the size, as in kiss_fftri
+		for (unsigned k=0; k<N/2; k++) {
+			double phase = 3.14159265358979323846264338327 * ((double)(k+1)/(N/2) + .5);
+			super[k] = complex<T>((T)cos(phase),(T)sin(phase));
+		}
+	}
+	void forward(const complex<T> *in, complex<T> *out) { fwd.run((const T*)in,(T*)out); }
+	void inverse(const complex<T> *in, T *out) {
+		const unsigned n = N/2;
+		static thread_local vector<complex<T> > tmp(n);	// packed half-size spectrum
+		tmp[0] = complex<T>(in[0].real() + in[n].real(), in[0].real() - in[n].real());
+		for (unsigned k=1; k<=n/2; k++) {
+			T fkr = in[k].real(), fki = in[k].imag();
+			T fnr = in[n-k].real(), fni = -in[n-k].imag();
+			T ekr = fkr + fnr, eki = fki + fni;
+			T dr = fkr - fnr, di = fki - fni;
+			T okr = dr*super[k-1].real() - di*super[k-1].imag();
+			T oki = dr*super[k-1].imag() + di*super[k-1].real();
+			tmp[k] = complex<T>(ekr + okr, eki + oki);
+			tmp[n-k] = complex<T>(ekr - okr, oki - eki);
+		}
+		inv.run((const T*)&tmp[0],out);
+	}
+	const char *name() { return "pow2"; }
+private:
+	pow2_fft<T,N,false> fwd;	// N-point complex transform
+	pow2_fft<T,N/2,true> inv;	// N/2-point complex inverse transform
+	vector<complex<T> > super;	// twiddles for the real-to-complex split
+};
+
+template<class T> fft_backend<T> *create_pow2_backend(unsigned N) {
+	switch (N) {
+	case 512: return new pow2_backend<T,512>();
+	case 1024: return new pow2_backend<T,1024>();
+	case 2048: return new pow2_backend<T,2048>();
+	case 4096: return new pow2_backend<T,4096>();
+	case 8192: return new pow2_backend<T,8192>();
+	default: return 0;
+	}
+}
+
+// kiss_fft in SIMD packs, one transform per lane (its state is placed in aligned memory, as the packs need)
+template<class V>
+class kiss_lane_backend: public fft_lane_backend<V> {
+public:
+	kiss_lane_backend(unsigned N): N(N), fwd_size(0), inv_size(0) {
+		kiss_fft_alloc<V>(N,0,0,&fwd_size);
+		kiss_fftr_alloc<V>(N,1,0,&inv_size);
+		fwd = kiss_fft_alloc<V>(N,0,simd::allocator<char>().allocate(fwd_size),&fwd_size);
+		inv = kiss_fftr_alloc<V>(N,1,simd::allocator<char>().allocate(inv_size),&inv_size);
+	}
+	~kiss_lane_backend() {
+		simd::allocator<char>().deallocate((char*)fwd,fwd_size);
+		simd::allocator<char>().deallocate((char*)inv,inv_size);
+	}
+	void forward(const V *in, V *out) { kiss_fft(fwd,(const kiss_fft_cpx<V>*)in,(kiss_fft_cpx<V>*)out); }
+	void inverse(const V *in, V *out) {
+		static thread_local vector<kiss_fft_cpx<V>,simd::allocator<kiss_fft_cpx<V> > > tmp;
+		if (tmp.size() < N/2)
+			tmp.resize(N/2);
+		kiss_fftri(inv,(const kiss_fft_cpx<V>*)in,out,&tmp[0]);
+	}
+	const char *name() { return "kiss"; }
+private:
+	unsigned N;
+	size_t fwd_size, inv_size;
+	kiss_fft_cfg<V> fwd;
+	kiss_fftr_cfg<V> inv;
+};
+
+// the pow2 transforms in SIMD packs, one per lane (with the same split of the real inverse transform as pow2_backend)
+template<class V, unsigned N>
+class pow2_lane_backend: public fft_lane_backend<V> {
+public:
+	pow2_lane_backend(): super(N) {
+		for (unsigned k=0; k<N/2; k++) {
+			double phase = 3.14159265358979323846264338327 * ((double)(k+1)/(N/2) + .5);
+			super[2*k] = (V)cos(phase);
+			super[2*k+1] = (V)sin(phase);
+		}
+	}
+	void forward(const V *in, V *out) { fwd.run(in,out); }
+	void inverse(const V *in, V *out) {
+		const unsigned n = N/2;
+		static thread_local vector<V,simd::allocator<V> > tmp(N);	// packed half-size spectrum
+		tmp[0] = in[0] + in[2*n];
+		tmp[1] = in[0] - in[2*n];
+		for (unsigned k=1; k<=n/2; k++) {
+			V fkr = in[2*k], fki = in[2*k+1];
+			V fnr = in[2*(n-k)], fni = -in[2*(n-k)+1];
+			V ekr = fkr + fnr, eki = fki + fni;
+			V dr = fkr - fnr, di = fki - fni;
+			V okr = dr*super[2*k-2] - di*super[2*k-1];
+			V oki = dr*super[2*k-1] + di*super[2*k-2];
+			tmp[2*k] = ekr + okr; tmp[2*k+1] = eki + oki;
+			tmp[2*(n-k)] = ekr - okr; tmp[2*(n-k)+1] = oki - eki;
+		}
+		inv.run(&tmp[0],out);
+	}
+	const char *name() { return "pow2"; }
+private:
+	pow2_fft<V,N,false> fwd;
+	pow2_fft<V,N/2,true> inv;
+	vector<V,simd::allocator<V> > super;	// twiddles for the real-to-complex split (interleaved)
+};
+
+template<class V> fft_lane_backend<V> *create_pow2_lane_backend(unsigned N) {
+	switch (N) {
+	case 512: return new pow2_lane_backend<V,512>();
+	case 1024: return new pow2_lane_backend<V,1024>();
+	case 2048: return new pow2_lane_backend<V,2048>();
+	case 4096: return new pow2_lane_backend<V,4096>();
+	case 8192: return new pow2_lane_backend<V,8192>();
+	default: return 0;
+	}
+}
+
+#ifdef FFT_POCKETFFT
+// pocketfft (header-only)
+template<class T>
+class pocketfft_backend: public fft_backend<T> {
+public:
+	pocketfft_backend(unsigned N): shape(1,N), cstride(1,sizeof(complex<T>)), rstride(1,sizeof(T)), axes(1,0) { }
+	void forward(const complex<T> *in, complex<T> *out) { pocketfft::c2c(shape,cstride,cstride,axes,pocketfft::FORWARD,in,out,T(1)); }
+	void inverse(const complex<T> *in, T *out) { pocketfft::c2r(shape,cstride,rstride,0,pocketfft::BACKWARD,in,out,T(1)); }
+	const char *name() { return "pocketfft"; }
+private:
+	pocketfft::shape_t shape;
+	pocketfft::stride_t cstride,rstride;
+	pocketfft::shape_t axes;
+};
+#endif
+
+#ifdef FFT_FFTW
+// FFTW (planned once per decoder; the plans work on any arrays, as long as the transforms are out of place)
+template<class T> class fftw_backend;
+
+template<>
+class fftw_backend<double>: public fft_backend<double> {
+public:
+	fftw_backend(unsigned N) {
+		vector<complex<double> > c(N),d(N);
+		vector<double> r(N);
+		fwd = fftw_plan_dft_1d(N,(fftw_complex*)&c[0],(fftw_complex*)&d[0],FFTW_FORWARD,FFTW_MEASURE|FFTW_UNALIGNED);
+		inv = fftw_plan_dft_c2r_1d(N,(fftw_complex*)&c[0],&r[0],FFTW_MEASURE|FFTW_UNALIGNED|FFTW_PRESERVE_INPUT);
+	}
+	~fftw_backend() { fftw_destroy_plan(fwd); fftw_destroy_plan(inv); }
+	void forward(const complex<double> *in, complex<double> *out) { fftw_execute_dft(fwd,(fftw_complex*)in,(fftw_complex*)out); }
+	void inverse(const complex<double> *in, double *out) { fftw_execute_dft_c2r(inv,(fftw_complex*)in,out); }
+	const char *name() { return "fftw"; }
+private:
+	fftw_plan fwd,inv;
+};
+
+template<>
+class fftw_backend<float>: public fft_backend<float> {
+public:
+	fftw_backend(unsigned N) {
+		vector<complex<float> > c(N),d(N);
+		vector<float> r(N);
+		fwd = fftwf_plan_dft_1d(N,(fftwf_complex*)&c[0],(fftwf_complex*)&d[0],FFTW_FORWARD,FFTW_MEASURE|FFTW_UNALIGNED);
+		inv = fftwf_plan_dft_c2r_1d(N,(fftwf_complex*)&c[0],&r[0],FFTW_MEASURE|FFTW_UNALIGNED|FFTW_PRESERVE_INPUT);
+	}
+	~fftw_backend() { fftwf_destroy_plan(fwd); fftwf_destroy_plan(inv); }
+	void forward(const complex<float> *in, complex<float> *out) { fftwf_execute_dft(fwd,(fftwf_complex*)in,(fftwf_complex*)out); }
+	void inverse(const complex<float> *in, float *out) { fftwf_execute_dft_c2r(inv,(fftwf_complex*)in,out); }
+	const char *name() { return "fftw"; }
+private:
+	fftwf_plan fwd,inv;
+};
+#endif
+
+vector<string> fft_backends() {
+	vector<string> result;
+	result.push_back("pow2");
+	result.push_back("kiss");
+#ifdef FFT_POCKETFFT
+	result.push_back("pocketfft");
+#endif
+#ifdef FFT_FFTW
+	result.push_back("fftw");
+#endif
+	return result;
+}
+
+template<class T> fft_backend<T> *create_fft_backend(unsigned N, const string &name) {
+	if (name.empty()) {
+		// the built-in backends only; the optional libraries are used when asked for by name
+		if (fft_backend<T> *f = create_pow2_backend<T>(N))
+			return f;
+		return new kiss_backend<T>(N);
+	}
+	const string &n = name;
+#ifdef FFT_FFTW
+	if (n == "fftw")
+		return new fftw_backend<T>(N);
+#endif
+#ifdef FFT_POCKETFFT
+	if (n == "pocketfft")
+		return new pocketfft_backend<T>(N);
+#endif
+	if (n == "pow2")
+		return create_pow2_backend<T>(N);
+	if (n == "kiss")
+		return new kiss_backend<T>(N);
+	return 0;
+}
+
+template fft_backend<double> *create_fft_backend<double>(unsigned,const string &);
+template fft_backend<float> *create_fft_backend<float>(unsigned,const string &);
+
+template<class V> fft_lane_backend<V> *create_fft_lane_backend(unsigned N, const string &name) {
+	if (name.empty() || name == "pow2")
+		if (fft_lane_backend<V> *f = create_pow2_lane_backend<V>(N))
+			return f;
+	if (name.empty() || name == "kiss")
+		return new kiss_lane_backend<V>(N);
+	return 0;
+}
+
+template fft_lane_backend<simd::vdouble> *create_fft_lane_backend<simd::vdouble>(unsigned,const string &);
+template fft_lane_backend<simd::vfloat> *create_fft_lane_backend<simd::vfloat>(unsigned,const string &);
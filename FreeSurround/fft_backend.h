@@ -0,0 +1,81 @@
+/*
+Copyright (C) 2021 Brian Barnes
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef FFT_BACKEND_H
+#define FFT_BACKEND_H
+#include <complex>
+#include <vector>
+#include <string>
+
+// optional backends, compiled in when they are present on this host
+#if defined(__has_include)
+#if __has_include("pocketfft_hdronly.h")
+#define FFT_POCKETFFT	// vendored header-only pocketfft (FreeSurround/pocketfft_hdronly.h)
+#endif
+#endif
+// FFT_FFTW is defined by the Makefile when pkg-config finds fftw3 and fftw3f
+
+// The pair of transforms the decoder needs for a block size of N samples, in the scalar type T.
+// Both are unnormalized (the scaling is folded into the window function), and both may be called by several
+// threads at once (any scratch space is kept per thread), so that decoders can share a backend.
+template<class T>
+class fft_backend {
+public:
+	virtual ~fft_backend() { }
+
+	// complex forward transform of N values (used for the packed Lt + i*Rt signal); in and out are distinct
+	virtual void forward(const std::complex<T> *in, std::complex<T> *out) = 0;
+
+	// real inverse transform of N/2+1 bins (hermitian half spectrum) into N samples; leaves the input intact
+	virtual void inverse(const std::complex<T> *in, T *out) = 0;
+
+	// name of the backend
+	virtual const char *name() = 0;
+};
+
+// names of the backends compiled into this build: the built-in ones (pow2, then kiss; the default is the first of
+// these that supports the block size), then the optional libraries
+std::vector<std::string> fft_backends();
+
+// create the given backend (or the default one, for an empty name) for N-point transforms;
+// returns 0 if no backend of that name is available
+template<class T> fft_backend<T> *create_fft_backend(unsigned N, const std::string &name = std::string());
+
+// The same pair of transforms for several independent signals at once, one in each lane of the SIMD pack V (see
+// simd.h): a complex value is stored as a pack of real parts followed by a pack of imaginary parts, and the arrays
+// must be aligned for V. Each lane gives the same result as the backend of that name for the scalar type.
+template<class V>
+class fft_lane_backend {
+public:
+	virtual ~fft_lane_backend() { }
+
+	// complex forward transform of N values (2N packs)
+	virtual void forward(const V *in, V *out) = 0;
+
+	// real inverse transform of N/2+1 bins (N+2 packs) into N samples; leaves the input intact
+	virtual void inverse(const V *in, V *out) = 0;
+
+	// name of the backend
+	virtual const char *name() = 0;
+};
+
+// create the given per-lane backend ("pow2" or "kiss"; the first one that supports the size for an empty name);
+// returns 0 if no backend of that name is available
+template<class V> fft_lane_backend<V> *create_fft_lane_backend(unsigned N, const std::string &name = std::string());
+
+#endif
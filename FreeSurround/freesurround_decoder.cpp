@@ -19,12 +19,26 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 #include <cmath>
 #include <vector>
 #include <complex>
-#include "kiss_fftr.h"
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <map>
+#include <tuple>
+#include <thread>
+#include <condition_variable>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#endif
+#include "fft_backend.h"
 #include "freesurround_decoder.h"
 #include "channelmaps.h"
+#include "simd.h"
 #pragma warning (disable: 4244)
 
-typedef std::complex<double> cplx;
 const float pi = 3.141592654f;
 const float epsilon = 0.000001f;
 using namespace std;
@@ -32,21 +46,245 @@ using namespace std;
 #undef min
 #undef max
 
-// FreeSurround implementation
-class decoder_impl {
+// interface of the FreeSurround implementation (independent of the working precision)
+class decoder_base {
 public:
-	// instantiate the decoder with a given channel setup and processing block size (in samples)
-	decoder_impl(channel_setup setup, unsigned N): N(N), wnd(N), inbuf(3*N), setup(setup),
-		C((unsigned)chn_alloc[setup].size()), buffer_empty(true), lt(N), rt(N), dst(N), lf(N/2+1), rf(N/2+1),
-		forward(kiss_fftr_alloc(N,0,0,0)), inverse(kiss_fftr_alloc(N,1,0,0))
+	virtual ~decoder_base() { }
+	virtual float *decode(float *input) = 0;
+	virtual size_t decode_many(const float *input, size_t frames, float *output, const unsigned *order) = 0;
+	virtual size_t decode_planar(const float *input, size_t frames, float *const *outputs) = 0;
+	virtual void flush() = 0;
+	virtual unsigned buffered() = 0;
+	virtual void set_circular_wrap(float v) = 0;
+	virtual void set_shift(float v) = 0;
+	virtual void set_depth(float v) = 0;
+	virtual void set_focus(float v) = 0;
+	virtual void set_center_image(float v) = 0;
+	virtual void set_front_separation(float v) = 0;
+	virtual void set_rear_separation(float v) = 0;
+	virtual void set_channel_mask(unsigned ids) = 0;
+	virtual void set_low_cutoff(float v) = 0;
+	virtual void set_high_cutoff(float v) = 0;
+	virtual void set_bass_redirection(bool v) = 0;
+	virtual void set_steering_resolution(unsigned v) = 0;
+	virtual float steering_error(unsigned res) = 0;
+	virtual unsigned set_steering_bands(unsigned n) = 0;
+	virtual void set_steering_interval(unsigned hops, float flux) = 0;
+	virtual void set_reference_phases(bool v) = 0;
+	virtual bool set_fft_implementation(const char *name) = 0;
+	virtual bool set_overlap(unsigned v) = 0;
+	virtual bool set_low_latency(unsigned hop) = 0;
+	virtual void set_silence_threshold(float v) = 0;
+	virtual void set_sparsity_threshold(float v) = 0;
+	virtual bool set_worker_threads(unsigned n, const int *cpus) = 0;
+	virtual unsigned latency() = 0;
+	virtual size_t hop_count(hop_path path) = 0;
+};
+
+// a number of channels, either fixed at compile time (NC) or given at runtime (NC=0)
+template<unsigned NC> struct channel_count {
+	channel_count(unsigned) { }
+	operator unsigned() const { return NC; }
+};
+template<> struct channel_count<0> {
+	channel_count(unsigned n): n(n) { }
+	operator unsigned() const { return n; }
+	unsigned n;
+};
+
+// a cache of immutable tables, each one built for its key when the first decoder asks for it and shared by all
+// decoders that use it; the cache holds no reference of its own, so a table goes away with the last of them
+template<class Key, class Table> class table_cache {
+public:
+	template<class Build> std::shared_ptr<Table> get(const Key &key, Build build) {
+		std::lock_guard<std::mutex> lock(mutex);
+		std::shared_ptr<Table> table = tables[key].lock();
+		if (!table) {
+			// (forget the tables that have been released in the meantime)
+			for (auto i=tables.begin();i!=tables.end();)
+				i = i->second.expired() ? tables.erase(i) : std::next(i);
+			table = build();
+			tables[key] = table;
+		}
+		return table;
+	}
+private:
+	std::mutex mutex;
+	std::map<Key,std::weak_ptr<Table> > tables;
+};
+
+// a pool of threads that run the tasks of a parallel section together with the thread that calls run(): each task
+// is taken from a shared counter by whichever thread gets to it first, and run() returns once every thread is done
+// (so that all writes of the tasks are visible to the caller, and no thread is still in the section when the next
+// one starts)
+class worker_pool {
+public:
+	// start the given number of threads, optionally pinning thread i to the CPU cpus[i] (unless that is negative);
+	// pinned() tells whether all of those could be pinned
+	worker_pool(unsigned threads, const int *cpus): generation(0), quit(false), tasks(0), busy(0), all_pinned(true) {
+		for (unsigned i=0;i<threads;i++) {
+			workers.emplace_back([this]() { work(); });
+			if (cpus && cpus[i] >= 0)
+				all_pinned = pin(workers.back(),cpus[i]) && all_pinned;
+		}
+	}
+
+	~worker_pool() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (auto &w : workers)
+			w.join();
+	}
+
+	// number of threads that take part in a section (including the caller)
+	unsigned size() const { return (unsigned)workers.size()+1; }
+
+	bool pinned() const { return all_pinned; }
+
+	// call fn(i) for every i in [0,n), spread across the threads
+	template<class F> void run(unsigned n, F fn) {
+		if (n < 2) {
+			if (n)
+				fn(0);
+			return;
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		job = &fn;
+		call = [](void *job, unsigned i) { (*(F*)job)(i); };
+		tasks = n;
+		next = 0;
+		busy = (unsigned)workers.size();
+		generation++;
+		lock.unlock();
+		wake.notify_all();
+		drain();
+		lock.lock();
+		done.wait(lock,[this]() { return !busy; });
+	}
+
+private:
+	void work() {
+		// the sections must round like the calling thread, which flushes denormals
+		simd::flush_denormals ftz;
+		for (unsigned seen=0;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock,[&]() { return quit || generation != seen; });
+				if (quit)
+					return;
+				seen = generation;
+			}
+			drain();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!--busy)
+				done.notify_one();
+		}
+	}
+
+	// take tasks until there are none left
+	void drain() {
+		for (unsigned i; (i = next.fetch_add(1,std::memory_order_relaxed)) < tasks;)
+			call(job,i);
+	}
+
+	static bool pin(std::thread &t, int cpu) {
+#if defined(_WIN32)
+		return cpu < 64 && SetThreadAffinityMask((HANDLE)t.native_handle(),DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+		if (cpu >= CPU_SETSIZE)
+			return false;
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(cpu,&set);
+		return pthread_setaffinity_np(t.native_handle(),sizeof(set),&set) == 0;
+#else
+		return false;
+#endif
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;	// signals a new section (or quit) to the workers
+	std::condition_variable done;	// signals the caller that the last worker has left the section
+	unsigned generation;			// number of sections started
+	bool quit;
+	void *job;						// the task function of the current section
+	void (*call)(void *job, unsigned i);
+	unsigned tasks;					// number of tasks in the current section
+	std::atomic<unsigned> next;		// the next task to be taken
+	unsigned busy;					// number of workers that have not left the current section yet
+	bool all_pinned;
+};
+
+// the transforms for a block size (and FFT implementation)
+template<class T> std::shared_ptr<fft_backend<T> > shared_transforms(unsigned N, const std::string &name = std::string()) {
+	static table_cache<std::pair<unsigned,std::string>,fft_backend<T> > cache;
+	return cache.get(std::make_pair(N,name),[&]() { return std::shared_ptr<fft_backend<T> >(create_fft_backend<T>(N,name)); });
+}
+
+// the same for several streams at once, one per lane of the SIMD pack V
+template<class V> std::shared_ptr<fft_lane_backend<V> > shared_lane_transforms(unsigned N, const std::string &name = std::string()) {
+	static table_cache<std::pair<unsigned,std::string>,fft_lane_backend<V> > cache;
+	return cache.get(std::make_pair(N,name),[&]() { return std::shared_ptr<fft_lane_backend<V> >(create_fft_lane_backend<V>(N,name)); });
+}
+
+// the window functions for a block size, hop size and synthesis window length (see decoder_impl::init_windows())
+template<class T> struct window_tables {
+	vector<T,simd::allocator<T> > wnd2;	// the analysis window function, duplicated for multiplexed stereo
+	vector<T,simd::allocator<T> > wnd;	// the synthesis window function
+};
+
+// the tables for a channel setup: its allocation maps, flattened (see decoder_impl::channel_setup_tables())
+template<class T> struct setup_tables {
+	vector<T,simd::allocator<T> > alloc; // channel allocation table, [q][p][channel]
+	vector<unsigned> side;			// side (0=L, 1=C, 2=R) whose phase each channel takes
+	struct center_fold { unsigned center, left, right; };
+	vector<center_fold> center_folds; // the front center channels, and the channels they are folded into
+};
+
+template<class T> class multi_decoder_impl;
+
+// FreeSurround implementation, working in the scalar type T (float or double), for NC output channels
+// (NC=0: any channel setup; otherwise the channel loops are resolved at compile time)
+template<class T, unsigned NC=0> class decoder_impl: public decoder_base {
+	// (which shares the steering and the tables of this one)
+	template<class> friend class multi_decoder_impl;
+public:
+	typedef std::complex<T> cplx;
+
+	// instantiate the decoder with a given channel setup and processing block size (in samples); its buffers go
+	// into the given memory if that is large enough and aligned to a cache line, or into an arena of its own
+	decoder_impl(channel_setup setup, unsigned N, void *mem, size_t lenmem): N(N), C((unsigned)chn_alloc[setup].size()),
+		setup(setup), ramp(0), mailbox(1), front(0), back(2), fft(shared_transforms<T>(N)), bins((N/2+W)/W*W),
+		CP((C-1+W-1)/W*W), buffer_empty(true)
 	{
-		// allocate per-channel buffers
-		outbuf.resize((N+N/2)*C);
-		signal.resize(C,vector<cplx>(N));
+		// carve all buffers out of one zeroed arena
+		arena_size = layout(N,C);
+		own_arena = !mem || lenmem < arena_size || ((size_t)mem & 63);
+		arena = own_arena ? simd::allocator<char>().allocate(arena_size) : (char*)mem;
+		memset(arena,0,arena_size);
+		layout(N,C,arena,this);
+		for (unsigned c=0;c<C;c++)
+			signal[c] = &spectra[c*bins];
+		for (unsigned k=0;k<3;k++) {
+			ure[k] = &phasors[k*bins];
+			uim[k] = &phasors[(3+k)*bins];
+		}
 
-		// init the window function
-		for (unsigned k=0;k<N;k++)
-			wnd[k] = sqrt(0.5*(1-cos(2*pi*k/N))/N);
+		// pick up the tables of the channel setup (the allocation table starts out without a center image folded in)
+		channel_tables = channel_setup_tables(setup,C);
+		side = &channel_tables->side[0];
+		std::copy(channel_tables->alloc.begin(),channel_tables->alloc.end(),alloc);
+		folded_center_image = 1;
+		// and the decimated LFE synthesis: an inverse transform of N/lfe_decimation points
+		const unsigned M = N/lfe_decimation;
+		if (M >= 16)
+			lfe_fft = shared_transforms<T>(M);
+		lfe_interp = lfe_weights();
+		xover_lo = xover_hi = -1;
 
 		// set default parameters
 		set_circular_wrap(90);
@@ -56,140 +294,947 @@ public:
 		set_center_image(1);
 		set_front_separation(1);
 		set_rear_separation(1);
+		set_channel_mask(~0u);
 		set_low_cutoff(40.0/22050);
 		set_high_cutoff(90.0/22050);
 		set_bass_redirection(false);
+		set_steering_resolution(0);
+		set_steering_bands(0);
+		set_steering_interval(1,0);
+		set_reference_phases(false);
+		set_silence_threshold(0);
+		set_sparsity_threshold(1e-12f);
+		set_overlap(2);
+		for (unsigned k=0;k<4;k++)
+			hops[k] = 0;
 	}
 
-	~decoder_impl() { delete forward; delete inverse; }
+	~decoder_impl() {
+		if (own_arena)
+			simd::allocator<char>().deallocate(arena,arena_size);
+	}
+
+	// lay out the buffers of a decoder for N samples and C channels in an arena, each aligned to a cache line, and
+	// point the members of d at them (if given, with the arena at base); returns the size of the arena
+	static size_t layout(unsigned N, unsigned C, char *base=0, decoder_impl *d=0) {
+		const size_t bins = (N/2+W)/W*W, CP = (C-1+W-1)/W*W, cells = grid_res*grid_res;
+		size_t size = 0;
+		auto carve = [&](auto member, size_t n) {
+			size = (size+63)/64*64;
+			if (d)
+				d->*member = (typename std::remove_reference<decltype(d->*member)>::type)(base+size);
+			size += n*sizeof(*(d->*member));
+		};
+		// (roughly in the order of use within a hop)
+		carve(&decoder_impl::inbuf,2*3*N);
+		carve(&decoder_impl::zt,N);
+		carve(&decoder_impl::zf,N);
+		carve(&decoder_impl::lre,bins); carve(&decoder_impl::lim,bins);
+		carve(&decoder_impl::rre,bins); carve(&decoder_impl::rim,bins);
+		carve(&decoder_impl::amp,bins);
+		carve(&decoder_impl::gp,bins); carve(&decoder_impl::gq,bins);
+		carve(&decoder_impl::gx,bins); carve(&decoder_impl::gy,bins);
+		carve(&decoder_impl::phasors,6*bins);
+		carve(&decoder_impl::alloc,cells*CP);
+		carve(&decoder_impl::vol,CP);
+		carve(&decoder_impl::power,CP);
+		carve(&decoder_impl::signal,C);
+		carve(&decoder_impl::spectra,C*bins);
+		carve(&decoder_impl::lfe_xover,N/2);
+		carve(&decoder_impl::lfe_dec,N/lfe_decimation);
+		carve(&decoder_impl::dst,C*N);
+		carve(&decoder_impl::dst_clear,C);
+		carve(&decoder_impl::tail,C*N);
+		carve(&decoder_impl::chp,C);
+		carve(&decoder_impl::outbuf,C*N);
+		return (size+63)/64*64;
+	}
 
 	// decode a stereo chunk, produces a multichannel chunk of the same size (lagged)
 	float *decode(float *input) {
-		// append incoming data to the end of the input buffer
-		memcpy(&inbuf[N], &input[0], 8*N);
-		// process first and second half, overlapped
-		buffered_decode(&inbuf[0]);
-		buffered_decode(&inbuf[N]);
-		// shift last half of the input to the beginning (for overlapping with a future block)
-		memcpy(&inbuf[0], &inbuf[2*N], 4*N);
-		buffer_empty = false;
+		decode_many(input,N,&outbuf[0],0);
 		return &outbuf[0];
 	}
 
+	// decode all whole stereo chunks in the input, writing the (lagged) multichannel chunks to output, multiplexed;
+	// order[i] is the channel written at position i of each frame (0 = the decoder's own order)
+	size_t decode_many(const float *input, size_t frames, float *output, const unsigned *order) {
+		for (unsigned c=0;c<C;c++)
+			chp[order ? order[c] : c] = output + c;
+		return decode_to(input,frames,&chp[0],C);
+	}
+
+	// decode all whole stereo chunks in the input, writing the (lagged) samples of channel c to outputs[c]
+	size_t decode_planar(const float *input, size_t frames, float *const *outputs) {
+		return decode_to(input,frames,outputs,1);
+	}
+
 	// flush the internal buffers
 	void flush() {
-		memset(&outbuf[0],0,outbuf.size()*4);
-		memset(&inbuf[0],0,inbuf.size()*4);
+		memset(&outbuf[0],0,4*C*N);
+		memset(&tail[0],0,4*C*N);
+		memset(&inbuf[0],0,4*2*3*N);
+		in_pos = 0;
 		buffer_empty = true;
+		// (the zeroed history is silent, and mono)
+		quiet_run = mono_run = N-H;
+		steer_pending = true;
+		// (the synthesis window may have moved)
+		std::fill(dst_clear,dst_clear+C,false);
 	}
 
 	// number of samples currently held in the buffer
-	unsigned buffered() { return buffer_empty ? 0 : N/2; }
+	unsigned buffered() { return buffer_empty ? 0 : N-H; }
+
+	// delay of the output relative to the input
+	unsigned latency() { return N-S-H; }
+
+	// number of hops that took the given path
+	size_t hop_count(hop_path path) { return hops[path]; }
 
 	// set soundfield & rendering parameters
-	void set_circular_wrap(float v) { circular_wrap = v; }
-	void set_shift(float v) { shift = v; }
-	void set_depth(float v) { depth = v; }
-	void set_focus(float v) { focus = v; }
-	void set_center_image(float v) { center_image = v; }
-	void set_front_separation(float v) { front_separation = v; }
-	void set_rear_separation(float v) { rear_separation = v; }
-	void set_low_cutoff(float v) { lo_cut = v*(N/2); }
-	void set_high_cutoff(float v) { hi_cut = v*(N/2); }
-	void set_bass_redirection(bool v) { use_lfe = v; }
+	// (safe to call from any thread while decoding, see publish())
+	void set_circular_wrap(float v) { publish([=](parameters &p) { p.circular_wrap = v; }); }
+	void set_shift(float v) { publish([=](parameters &p) { p.shift = v; }); }
+	void set_depth(float v) { publish([=](parameters &p) { p.depth = v; }); }
+	void set_focus(float v) { publish([=](parameters &p) { p.focus = v; }); }
+	void set_center_image(float v) { publish([=](parameters &p) { p.center_image = v; }); }
+	void set_front_separation(float v) { publish([=](parameters &p) { p.front_separation = v; }); }
+	void set_rear_separation(float v) { publish([=](parameters &p) { p.rear_separation = v; }); }
+	void set_channel_mask(unsigned ids) { publish([=](parameters &p) { p.channels = ids; }); }
+	void set_low_cutoff(float v) { publish([=](parameters &p) { p.lo_cut = v*(N/2); }); }
+	void set_high_cutoff(float v) { publish([=](parameters &p) { p.hi_cut = v*(N/2); }); }
+	void set_bass_redirection(bool v) { publish([=](parameters &p) { p.lfe = v; }); }
+	void set_steering_resolution(unsigned v) { lut_res = v ? std::max(v,2u) : 0; lut_dirty = steer_pending = true; }
+	float steering_error(unsigned res) {
+		parameters p;
+		{
+			std::lock_guard<std::mutex> lock(control);
+			p = staging;
+		}
+		res = std::max(res,2u);
+		vector<T> table;
+		tabulate_positions(p,res,table);
+		// compare at four points per cell and axis (including the nodes)
+		const unsigned K = 4*(res-1);
+		double worst = 0;
+		for (unsigned i=0;i<=K;i++) {
+			for (unsigned j=0;j<=K;j++) {
+				T ampDiff = T(2.0*j/K-1), phaseDiff = T(pi*i/K), x,y,tx,ty;
+				transform_position(p,ampDiff,phaseDiff,x,y);
+				lookup_position(table,res,ampDiff,phaseDiff,tx,ty);
+				worst = std::max(worst,std::hypot(double(tx-x),double(ty-y)));
+			}
+		}
+		return (float)worst;
+	}
+	void set_reference_phases(bool v) { reference_phases = v; steer_pending = true; }
+	void set_steering_interval(unsigned hops, float flux) {
+		interval = std::max(hops,1u);
+		flux_threshold = flux;
+		since_steering = 0;
+		steer_pending = true;
+		mag.assign(interval > 1 && flux > 0 ? 4*bins : 0,0);
+	}
+	unsigned set_steering_bands(unsigned n) {
+		// band edges evenly spaced on the ERB-rate scale (for a nominal 44.1 kHz sampling rate), at least one bin apart,
+		// covering the bins 1..N/2-1
+		band_start.clear();
+		for (unsigned i=0;n && i<=n;i++) {
+			double erbs = i*erb_rate(22050)/n, hz = (pow(10,erbs/21.4)-1)/0.00437;
+			unsigned f = std::min(std::max((unsigned)(hz*N/44100+0.5),1u),N/2);
+			if (band_start.empty() || f > band_start.back())
+				band_start.push_back(f);
+		}
+		bands = band_start.empty() ? 0 : (unsigned)band_start.size()-1;
+		steer_pending = true;
+		const unsigned padded = (bands+W-1)/W*W;
+		bel.assign(padded,0); ber.assign(padded,0); bcr.assign(padded,0); bci.assign(padded,0);
+		bgp.assign(padded,0); bgq.assign(padded,0); bgx.assign(padded,0); bgy.assign(padded,0);
+		bvol.assign((bands+1)*CP,0);
+		// each bin takes its volumes from the bands whose centers enclose it, interpolated linearly
+		band_of.assign(N/2,0);
+		band_frac.assign(N/2,0);
+		for (unsigned f=1,b=0;bands && f<N/2;f++) {
+			while (b+1 < bands && f >= band_center(b+1))
+				b++;
+			band_of[f] = b;
+			if (b+1 < bands)
+				band_frac[f] = T(std::max(0.0,(f-band_center(b))/(band_center(b+1)-band_center(b))));
+		}
+		return bands;
+	}
+	bool set_fft_implementation(const char *name) {
+		std::shared_ptr<fft_backend<T> > f = shared_transforms<T>(N,name);
+		if (!f)
+			return false;
+		fft = f;
+		return true;
+	}
+	bool set_overlap(unsigned v) {
+		if (v != 2 && v != 4 && v != 8)
+			return false;
+		init_windows(N/v,N);
+		return true;
+	}
+	bool set_low_latency(unsigned hop) {
+		if (!hop || N % hop || 2*hop > N)
+			return false;
+		init_windows(hop,2*hop);
+		return true;
+	}
+	void set_silence_threshold(float v) { silence_threshold = v; }
+	void set_sparsity_threshold(float v) { sparsity_threshold = v; }
+	bool set_worker_threads(unsigned n, const int *cpus) {
+		pool.reset();
+		if (n)
+			pool.reset(new worker_pool(n,cpus));
+		return !pool || pool->pinned();
+	}
 
 private:
+	// the soundfield & rendering parameters, as one block
+	struct parameters {
+		float circular_wrap;		// angle of the front soundstage around the listener (90�=default)
+		float shift;				// forward/backward offset of the soundstage
+		float depth;				// backward extension of the soundstage
+		float focus;				// localization of the sound events
+		float center_image;			// presence of the center speaker
+		float front_separation;		// front stereo separation
+		float rear_separation;		// rear stereo separation
+		float lo_cut, hi_cut;		// LFE cutoff frequencies, in bins
+		float lfe;					// amount of bass redirected into the LFE channel (0 or 1, in between while ramping)
+		unsigned channels;			// channel_ids of the channels that are rendered (the others are muted)
+	};
+	static constexpr float parameters::*ramped[] = {&parameters::circular_wrap, &parameters::shift, &parameters::depth,
+		&parameters::focus, &parameters::center_image, &parameters::front_separation, &parameters::rear_separation,
+		&parameters::lo_cut, &parameters::hi_cut, &parameters::lfe};
+
+	// change the parameters and hand them to the decoding thread, through a triple buffer: the new block is written
+	// to the back slot, which is then swapped with the one in the mailbox (flagged as fresh); the control threads
+	// only serialize among themselves, and the decoding thread never waits
+	template<class F> void publish(F change) {
+		std::lock_guard<std::mutex> lock(control);
+		change(staging);
+		slots[back] = staging;
+		back = mailbox.exchange(back|fresh,std::memory_order_acq_rel) & 3;
+	}
+
+	// at the start of each hop: pick up freshly published parameters, and move the current ones a step towards them
+	// (so that a change is ramped in over one block; it takes effect at once while nothing is buffered)
+	void update_parameters() {
+		if (mailbox.load(std::memory_order_relaxed) & fresh) {
+			front = mailbox.exchange(front,std::memory_order_acq_rel) & 3;
+			target = slots[front];
+			ramp = buffer_empty ? 1 : N/H;
+			// (muting is not ramped: the overlap-add fades a channel out or in over one block)
+			cur.channels = target.channels;
+		}
+		if (ramp) {
+			for (auto field : ramped)
+				cur.*field = ramp == 1 ? target.*field : cur.*field + (target.*field - cur.*field)/ramp;
+			ramp--;
+			lut_dirty = steer_pending = true;
+			if (cur.center_image != folded_center_image)
+				fold_center_image();
+			if (cur.lo_cut != xover_lo || cur.hi_cut != xover_hi)
+				build_crossover();
+			// the LFE range may have shrunk
+			std::fill(signal[C-1],signal[C-1]+bins,cplx(0));
+		}
+	}
+
+	// tabulate the level of the LFE channel per bin (a raised-cosine transition from lo_cut to hi_cut)
+	void build_crossover() {
+		crossover(N,cur.lo_cut,cur.hi_cut,lfe_xover);
+		xover_lo = cur.lo_cut;
+		xover_hi = cur.hi_cut;
+	}
+	static void crossover(unsigned N, float lo_cut, float hi_cut, double *xover) {
+		for (unsigned f=1;f<N/2 && f<hi_cut;f++)
+			xover[f] = f < lo_cut ? 1 : 0.5*(1+cos(pi*(f-lo_cut)/(hi_cut-lo_cut)));
+	}
+
+	// fold the center image setting into the channel allocation table: the share of each front center channel's
+	// power that is taken away goes to its neighbors in equal parts, as a phantom center; this touches every cell
+	// of the table once (grid_res^2 * CP values), and is done at most once per hop while the setting ramps
+	void fold_center_image() {
+		fold_center_image(*channel_tables,CP,cur.center_image,alloc);
+		folded_center_image = cur.center_image;
+	}
+	static void fold_center_image(const setup_tables<T> &tables, unsigned CP, float center_image, T *alloc) {
+		std::copy(tables.alloc.begin(),tables.alloc.end(),alloc);
+		const T keep = sqrt(std::max(center_image,0.0f)), give = sqrt(std::max(1-center_image,0.0f)/2);
+		for (unsigned k=0;k<grid_res*grid_res && keep != 1;k++) {
+			T *a = &alloc[k*CP];
+			for (auto &f : tables.center_folds) {
+				const T v = a[f.center];
+				a[f.center] = keep*v;
+				a[f.left] += give*v;
+				a[f.right] += give*v;
+			}
+		}
+	}
+
+	// the SIMD pack used by the spectral kernels, and the number of bins it holds
+	typedef typename simd::pack<T>::type vec;
+	enum { W = simd::lanes<vec>::width };
+
 	// helper functions
 	static inline float sqr(double x) { return x*x; }
-	static inline double amplitude(const cplx &x) { return sqrt(sqr(x.real()) + sqr(x.imag())); }
-	static inline double phase(const cplx &x) { return atan2(x.imag(),x.real()); }
-	static inline cplx polar(double a, double p) { return cplx(a*cos(p),a*sin(p)); }
 	static inline float min(double a, double b) { return a<b?a:b; }
 	static inline float max(double a, double b) { return a>b?a:b; }
-	static inline float clamp(double x) { return max(-1,min(1,x)); }
+	template<class V> static inline V clamp(V x) { return simd::max(V(-1),simd::min(V(1),x)); }
 	static inline float sign(double x) { return x<0?-1:(x>0?1:0); }
+	// number of ERBs below a frequency (in Hz)
+	static inline double erb_rate(double hz) { return 21.4*log10(1+0.00437*hz); }
+	// center of a steering band, in bins
+	inline double band_center(unsigned b) { return 0.5*(band_start[b] + band_start[b+1] - 1); }
 	// get the distance of the soundfield edge, along a given angle
 	static inline double edgedistance(double a) { return min(sqrt(1+sqr(tan(a))),sqrt(1+sqr(1/tan(a)))); }
 	// get the index (and fractional offset!) in a piecewise-linear channel allocation grid
-	int map_to_grid(double &x) { double gp=((x+1)*0.5)*(grid_res-1), i=min(grid_res-2,floor(gp)); x = gp-i; return i; }
+	template<class V> static inline V map_to_grid(V &x) { V gp=((x+1)*0.5)*(grid_res-1), i=simd::min(V(grid_res-2),simd::floor(gp)); x = gp-i; return i; }
+	// get the unit phasor of re/im (given its magnitude); a zero vector has phase 0
+	template<class V> static inline void unit_phasor(V re, V im, V mag, V &ure, V &uim) {
+		V nonzero = mag > 0, inv = 1/simd::select(nonzero,mag,V(1));
+		ure = simd::select(nonzero,re*inv,V(1));
+		uim = simd::select(nonzero,im*inv,V(0));
+	}
+	// apply a scalar soundfield transformation to each lane of x/y
+	template<class V, class F> static inline void per_lane(V &x, V &y, F transform) {
+		T xs[simd::lanes<V>::width], ys[simd::lanes<V>::width];
+		simd::store(xs,x); simd::store(ys,y);
+		for (unsigned j=0;j<simd::lanes<V>::width;j++) {
+			double xd = xs[j], yd = ys[j];
+			transform(xd,yd);
+			xs[j] = xd; ys[j] = yd;
+		}
+		simd::load(x,xs); simd::load(y,ys);
+	}
 
-	// decode a block of data and overlap-add it into outbuf
-	void buffered_decode(float *input) {
-		// demultiplex and apply window function
-		for (unsigned k=0;k<N;k++) {
-			lt[k] = wnd[k]*input[k*2+0];
-			rt[k] = wnd[k]*input[k*2+1];
-		}
-
-		// map into spectral domain
-		kiss_fftr(forward,&lt[0],(kiss_fft_cpx*)&lf[0]);
-		kiss_fftr(forward,&rt[0],(kiss_fft_cpx*)&rf[0]);
-
-		// compute multichannel output signal in the spectral domain
-		for (unsigned f=1;f<N/2;f++) {
-			// get Lt/Rt amplitudes & phases
-			double ampL = amplitude(lf[f]), ampR = amplitude(rf[f]);
-			double phaseL = phase(lf[f]), phaseR = phase(rf[f]);
-			// calculate the amplitude & phase differences
-			double ampDiff = clamp((ampL+ampR < epsilon) ? 0 : (ampR-ampL) / (ampR+ampL));
-			double phaseDiff = abs(phaseL - phaseR);
-			if (phaseDiff > pi) phaseDiff = 2*pi - phaseDiff;
-
-			// decode into x/y soundfield position
-			double x,y; transform_decode(ampDiff,phaseDiff,x,y);
-			// add wrap control
-			transform_circular_wrap(x,y,circular_wrap);
-			// add shift control
-			y = clamp(y - shift);
-			// add depth control
-			y = clamp(1 - (1-y)*depth);
-			// add focus control
-			transform_focus(x,y,focus);
-			// add crossfeed control
-			x = clamp(x * (front_separation*(1+y)/2 + rear_separation*(1-y)/2));
-
-			// get total signal amplitude
-			double amp_total = sqrt(ampL*ampL + ampR*ampR);
-			// and total L/C/R signal phases
-			double phase_of[] = {phaseL,atan2(lf[f].imag()+rf[f].imag(),lf[f].real()+rf[f].real()),phaseR};
-			// compute 2d channel map indexes p/q and update x/y to fractional offsets in the map grid
-			int p=map_to_grid(x), q=map_to_grid(y);
-			// map position to channel volumes
+	// set up the windows for a hop size of hop samples, with a synthesis window that covers the last len samples
+	// of each block (len=N: symmetric sqrt-Hann windows; len<N: asymmetric low-delay windows)
+	void init_windows(unsigned hop, unsigned len) {
+		windows = window_functions(N,hop,len);
+		wnd2 = &windows->wnd2[0];
+		wnd = &windows->wnd[0];
+		H = hop;
+		S = N-len;
+		flush();
+	}
+
+	// the window functions for N samples, a hop size and a synthesis window length (see init_windows())
+	static std::shared_ptr<const window_tables<T> > window_functions(unsigned N, unsigned hop, unsigned len) {
+		static table_cache<std::tuple<unsigned,unsigned,unsigned>,const window_tables<T> > cache;
+		const unsigned S = N-len;
+		return cache.get(std::make_tuple(N,hop,len),[=]() {
+			std::shared_ptr<window_tables<T> > w = std::make_shared<window_tables<T> >();
+			w->wnd2.resize(2*N);
+			w->wnd.resize(N);
+			for (unsigned k=0;k<N;k++) {
+				// analysis: the rising half of a Hann window up to N-len/2, then the falling half of one of length len (square-rooted)
+				T a = k < N-len/2 ? sqrt(0.5*(1-cos(2*pi*k/(2*N-len)))/N) : sqrt(0.5*(1-cos(2*pi*(k-S)/len))/N);
+				w->wnd2[2*k+0] = w->wnd2[2*k+1] = a;
+				// synthesis: such that the product is a Hann window of length len, scaled to overlap-add to one at this hop
+				if (k < S)
+					w->wnd[k] = 0;
+				else if (len == N || k >= N-len/2)
+					w->wnd[k] = a*T(2.0*hop/len);
+				else
+					w->wnd[k] = T(0.5*(1-cos(2*pi*(k-S)/len))/N/a*(2.0*hop/len));
+			}
+			return w;
+		});
+	}
+
+	// the tables of a channel setup with C channels: its allocation maps, copied into one flat table, laid out
+	// [q][p][channel] (channels padded to whole SIMD packs), the side (L/C/R) whose phase each channel takes, and the
+	// channels that each front center channel is folded into: its nearest neighbors on either side in the same row
+	static std::shared_ptr<const setup_tables<T> > channel_setup_tables(channel_setup setup, unsigned C) {
+		static table_cache<channel_setup,const setup_tables<T> > cache;
+		return cache.get(setup,[=]() {
+			std::shared_ptr<setup_tables<T> > t = std::make_shared<setup_tables<T> >();
+			const unsigned CP = (C-1+W-1)/W*W;
+			t->alloc.resize(grid_res*grid_res*CP);
+			for (unsigned q=0;q<grid_res;q++)
+				for (unsigned p=0;p<grid_res;p++)
+					for (unsigned c=0;c<C-1;c++)
+						t->alloc[(q*grid_res+p)*CP+c] = chn_alloc[setup][c][q][p];
+			for (unsigned c=0;c<C-1;c++)
+				t->side.push_back(1+(int)sign(chn_xsf[setup][c]));
+			const vector<float> &xsf = chn_xsf[setup], &ysf = chn_ysf[setup];
 			for (unsigned c=0;c<C-1;c++) {
-				// look up channel map at respective position (with bilinear interpolation) and build the signal
-				vector<float*> &a = chn_alloc[setup][c];
-				signal[c][f] = polar(amp_total*((1-x)*(1-y)*a[q][p] + x*(1-y)*a[q][p+1] + (1-x)*y*a[q+1][p] + x*y*a[q+1][p+1]),
-					phase_of[1+(int)sign(chn_xsf[setup][c])]);
+				if (chn_id[setup][c] != ci_front_center)
+					continue;
+				int left = -1, right = -1;
+				for (unsigned n=0;n<C-1;n++) {
+					if (ysf[n] != ysf[c])
+						continue;
+					if (xsf[n] < xsf[c] && (left < 0 || xsf[n] > xsf[left]))
+						left = n;
+					if (xsf[n] > xsf[c] && (right < 0 || xsf[n] < xsf[right]))
+						right = n;
+				}
+				if (left >= 0 && right >= 0)
+					t->center_folds.push_back({c,(unsigned)left,(unsigned)right});
+			}
+			return t;
+		});
+	}
+
+	// the weights of the LFE interpolation at each of the lfe_decimation phases (Lagrange polynomials over
+	// nodes -2..3), [tap][phase]
+	static const T *lfe_weights() {
+		static const vector<T> weights = []() {
+			vector<T> w(lfe_taps*lfe_decimation);
+			for (unsigned j=0;j<lfe_decimation;j++)
+				for (int i=0;i<lfe_taps;i++) {
+					double t = (double)j/lfe_decimation, v = 1;
+					for (int n=0;n<lfe_taps;n++)
+						if (n != i)
+							v *= (t-(n-2))/(i-n);
+					w[i*lfe_decimation+j] = v;
+				}
+			return w;
+		}();
+		return &weights[0];
+	}
+
+	// decode all whole hops in the input, writing sample k of output channel c to out[c][k*stride]
+	size_t decode_to(const float *input, size_t frames, float *const *out, size_t stride) {
+		simd::flush_denormals ftz;
+		frames -= frames % H;
+		if (!frames)
+			return 0;
+		// process the input hop by hop, each time decoding the last N samples; the blocks of the first hops of a call
+		// overlap with the last N-H samples of the previous call, and are read from the input ring after the first
+		// frames have been appended to it, the later ones straight from the input
+		const size_t L = N-H, head = std::min<size_t>(frames,L), base = in_pos;
+		append(&input[0],head);
+		for (size_t p=0;p<frames;p+=H)
+			buffered_decode(p < L ? &inbuf[2*((base+p+2*N-L)%(2*N))] : &input[2*(p-L)],out,stride,p);
+		// keep the last N-H samples of the input (for overlapping with future hops)
+		if (frames > head) {
+			const size_t from = std::max<size_t>(head,frames-L);
+			append(&input[2*from],frames-from);
+		}
+		buffer_empty = false;
+		return frames;
+	}
+
+	// append frames to the input ring (of 2N frames, whose first N are mirrored behind its end, so that any N
+	// consecutive frames can be read in one piece)
+	void append(const float *input, size_t frames) {
+		while (frames) {
+			const size_t n = std::min<size_t>(frames,2*N-in_pos);
+			memcpy(&inbuf[2*in_pos],input,8*n);
+			if (in_pos < N)
+				memcpy(&inbuf[2*(in_pos+2*N)],input,8*std::min<size_t>(n,N-in_pos));
+			in_pos = (in_pos+n) % (2*N);
+			input += 2*n;
+			frames -= n;
+		}
+	}
+
+	// decode a block of data and overlap-add it with the tail of the previous ones, producing H samples of output
+	// (starting at sample pos of the output channels)
+	void buffered_decode(const float *input, float *const *out, size_t stride, size_t pos) {
+		update_parameters();
+
+		// render the block into the time-domain destination buffer (from S on), taking a shortcut if it is silent
+		// or mono
+		hop_path path = classify(input);
+		if (path == hp_silent) {
+			for (unsigned c=0;c<C;c++)
+				clear(c);
+		} else if (path == hp_mono)
+			render_mono(input);
+		else
+			path = render(input);
+		hops[path]++;
+		// (the shortcuts leave no positions to reuse)
+		if (path == hp_silent || path == hp_mono)
+			steer_pending = true;
+
+		// with a worker pool, transform the channels back (after a spectral rendering) one per task, and split the
+		// overlap-add by output sample
+		if (pool) {
+			if (path == hp_full || path == hp_reused)
+				pool->run(C,[&](unsigned c) { transform_back(c); });
+			const unsigned n = pool->size(), piece = (H/n+15)/16*16;
+			pool->run(n,[&](unsigned i) { overlap_add(std::min(i*piece,H),std::min((i+1)*piece,H),out,stride,pos); });
+		} else
+			overlap_add(0,H,out,stride,pos);
+	}
+
+	// overlap-add the part of the block covered by the synthesis window (from S on), remultiplexing all channels in
+	// one pass: the first H samples complete the output together with the tail (windowed), and the rest is added to
+	// the tail (moving it up by H); this covers the samples at the offsets [j0,j1) within each hop, whose tail only
+	// moves among themselves, so that disjoint ranges of offsets can be overlap-added at the same time
+	void overlap_add(unsigned j0, unsigned j1, float *const *out, size_t stride, size_t pos) {
+		const unsigned L = N-S-H;
+		for (unsigned h=0;h<L;h+=H) {
+			for (unsigned k=h+j0;k<h+j1;k++) {
+				const T *d = &dst[S+k], w0 = wnd[S+k], w1 = wnd[S+k+H];
+				float *t = &tail[C*k];
+				if (k < H) {
+					const size_t o = (pos+k)*stride;
+					for (unsigned c=0;c<C;c++)
+						out[c][o] = t[c] + w0*d[c*N];
+				}
+				if (k < L-H) {
+					for (unsigned c=0;c<C;c++)
+						t[c] = t[c+C*H] + w1*d[c*N+H];
+				} else {
+					for (unsigned c=0;c<C;c++)
+						t[c] = w1*d[c*N+H];
+				}
+			}
+		}
+	}
+
+	// find out how the block can be processed, from the run lengths of silent and of mono input samples that end
+	// with its last hop
+	hop_path classify(const float *input) {
+		const float *last = &input[2*(N-H)];
+		unsigned k = H;
+		while (k && std::abs(last[2*k-2]) <= silence_threshold && std::abs(last[2*k-1]) <= silence_threshold)
+			k--;
+		quiet_run = k ? H-k : std::min(quiet_run+H,N);
+		for (k=H; k && last[2*k-2] == last[2*k-1]; k--);
+		mono_run = k ? H-k : std::min(mono_run+H,N);
+		if (silence_threshold < 0)
+			return hp_full;
+		if (quiet_run >= N)
+			return hp_silent;
+		// (bass redirection makes the gains frequency-dependent)
+		if (mono_run >= N && cur.lfe == 0)
+			return hp_mono;
+		return hp_full;
+	}
+
+	// render a mono block: every channel then carries the signal, scaled by the gain of a centered source, so the
+	// transforms cancel out (except for DC and Nyquist, which are not carried over and are subtracted here)
+	void render_mono(const float *input) {
+		// get the gains by steering a single bin with L = R = 1
+		for (unsigned f=0;f<W;f++) {
+			lre[f] = rre[f] = 1;
+			lim[f] = rim[f] = 0;
+		}
+		if (lut_res && lut_dirty)
+			build_steering_lut();
+		steer<vec>(0);
+		synthesize(0,0,CP);
+		// the DC and Nyquist components of the windowed block
+		T *z = (T*)&zt[0];
+		T dc = 0, nyquist = 0;
+		for (unsigned k=0;k<N;k++) {
+			z[k] = wnd2[2*k]*input[2*k];
+			dc += z[k];
+			nyquist += k & 1 ? -z[k] : z[k];
+		}
+		for (unsigned k=S;k<N;k++)
+			z[k] = N*z[k] - dc - (k & 1 ? -nyquist : nyquist);
+		for (unsigned c=0;c<C-1;c++) {
+			const T gain = signal[c][0].real();
+			if (!rendered(c) || gain == 0) {
+				clear(c);
+				continue;
 			}
+			for (unsigned k=S;k<N;k++)
+				dst[c*N+k] = gain*z[k];
+			dst_clear[c] = false;
+		}
+		clear(C-1);
+	}
+
+	// render a block through the spectral domain: analysis, steering and synthesis of every channel; returns
+	// hp_reused if the soundfield positions of an earlier block were reused
+	hop_path render(const float *input) {
+		// apply the window function, packing left total into the real and right total into the imaginary part
+		// (the multiplexed input already has that layout)
+		T *z = (T*)&zt[0];
+		for (unsigned k=0;k<2*N;k++)
+			z[k] = wnd2[k]*input[k];
+
+		// map both into the spectral domain with a single complex FFT
+		fft->forward(&zt[0],&zf[0]);
+
+		// separate the two spectra using their hermitian symmetry (L = (Z[f] + Z*[N-f])/2, R = (Z[f] - Z*[N-f])/2i)
+		// and split them into real & imaginary parts
+		for (unsigned f=0;f<=N/2;f++) {
+			cplx a = zf[f], b = zf[f ? N-f : 0];
+			lre[f] = (a.real() + b.real())*T(0.5); lim[f] = (a.imag() - b.imag())*T(0.5);
+			rre[f] = (a.imag() + b.imag())*T(0.5); rim[f] = (b.real() - a.real())*T(0.5);
+		}
 
-			// optionally redirect bass
-			if (use_lfe && f < hi_cut) {
+		// compute the soundfield position of every bin (or of every band), W at a time, unless the positions of the
+		// last steered block are reused (then only the amplitudes and phasors are updated)
+		if (lut_res && lut_dirty)
+			build_steering_lut();
+		// (with a worker pool, the bins are split into one contiguous range per thread)
+		const bool positions = steering_due();
+		const bool phasors_only = bands || !positions;
+		auto steer_bins = [&](unsigned f0, unsigned f1) {
+			for (unsigned f=f0;f<f1;f+=W) {
+				if (phasors_only)
+					steer<vec,false>(f);
+				else
+					steer<vec>(f);
+			}
+		};
+		if (pool) {
+			const unsigned n = pool->size(), piece = (bins/n+15)/16*16;
+			pool->run(n,[&](unsigned i) { steer_bins(std::min(i*piece,bins),std::min((i+1)*piece,bins)); });
+		} else
+			steer_bins(0,bins);
+		if (bands && positions)
+			steer_bands();
+
+		// map positions to channel volumes and build the multichannel output signal in the spectral domain (with a
+		// worker pool, one pack of channels per task, so that the power of each channel is summed up in the same
+		// order as without)
+		if (pool)
+			pool->run(CP/W,[&](unsigned i) { synthesize_channels(i*W,(i+1)*W); });
+		else
+			synthesize_channels(0,CP);
+
+		// back-transform each channel into time domain, except for those that are muted or carry (next to) nothing
+		// in this block: they contribute silence (with a worker pool, this is left to buffered_decode())
+		T total = 0;
+		for (unsigned c=0;c<C-1;c++)
+			total += power[c];
+		sparse_level = sparsity_threshold*total;
+		if (!pool) {
+			for (unsigned c=0;c<C;c++)
+				transform_back(c);
+		}
+		return positions ? hp_full : hp_reused;
+	}
+
+	// build the spectra of the channels [c0,c1) (whole packs, up to CP) from the soundfield positions, summing up
+	// their power, and optionally redirect their bass (the first pack also builds the LFE channel)
+	void synthesize_channels(unsigned c0, unsigned c1) {
+		std::fill(power+c0,power+c1,T(0));
+		if (bands) {
+			for (unsigned f=1;f<N/2;f++)
+				synthesize_banded(f,c0,c1);
+		} else {
+			for (unsigned f=1;f<N/2;f++)
+				synthesize(f,c0,c1);
+		}
+		const unsigned last = std::min<unsigned>(c1,C-1);
+		// DC and Nyquist are not carried over
+		for (unsigned c=c0;c<last;c++)
+			signal[c][0] = signal[c][N/2] = 0;
+
+		// optionally redirect bass
+		if (cur.lfe > 0) {
+			for (unsigned f=1;f<N/2 && f<cur.hi_cut;f++) {
 				// level of LFE channel according to normalized frequency
-				double lfe_level = f < lo_cut ? 1 : 0.5*(1+cos(pi*(f-lo_cut)/(hi_cut-lo_cut)));
+				double lfe_level = cur.lfe * lfe_xover[f];
 				// assign LFE channel
-				signal[C-1][f] = lfe_level * polar(amp_total,phase_of[1]);
+				if (!c0)
+					signal[C-1][f] = T(lfe_level * amp[f]) * cplx(ure[1][f],uim[1][f]);
 				// subtract the signal from the other channels
-				for (unsigned c=0;c<C-1;c++)
+				for (unsigned c=c0;c<last;c++)
 					signal[c][f] *= (1-lfe_level);
 			}
 		}
+	}
+
+	// back-transform channel c of a spectrally rendered block, unless it is muted or carries (next to) nothing
+	void transform_back(unsigned c) {
+		if (c == C-1) {
+			if (rendered(C-1) && cur.lfe > 0)
+				synthesize_lfe();
+			else
+				clear(C-1);
+		} else if (rendered(c) && power[c] > sparse_level) {
+			fft->inverse(&signal[c][0],&dst[c*N]);
+			dst_clear[c] = false;
+		} else
+			clear(c);
+	}
+
+	// whether channel c is rendered at all
+	bool rendered(unsigned c) { return (chn_id[setup][c] & cur.channels) != 0; }
 
-		// shift the last 2/3 to the first 2/3 of the output buffer
-		memcpy(&outbuf[0], &outbuf[C*N/2], N*C*4);
-		// and clear the rest
-		memset(&outbuf[C*N], 0, C*4*N/2);
-		// backtransform each channel and overlap-add
-		for (unsigned c=0;c<C;c++) {
-			// back-transform into time domain
-			kiss_fftri(inverse,(kiss_fft_cpx*)&signal[c][0],&dst[0]);
-			// add the result to the last 2/3 of the output buffer, windowed (and remultiplex)
-			for (unsigned k=0;k<N;k++)
-				outbuf[C*(k+N/2)+c] += wnd[k]*dst[k];
+	// make channel c contribute silence to this hop (its destination is zeroed once, then left as it is)
+	void clear(unsigned c) {
+		if (!dst_clear[c]) {
+			std::fill(&dst[c*N+S],&dst[c*N+N],T(0));
+			dst_clear[c] = true;
 		}
 	}
 
+	// back-transform the LFE channel: its spectrum ends below hi_cut, so while that is below 1/16 of the bins of an
+	// M = N/lfe_decimation point transform, that one gives every lfe_decimation'th sample of the block exactly
+	// (the inputs are the same first bins), and the samples in between are interpolated (to ca. -110 dB at that
+	// cutoff); otherwise the full transform is used
+	void synthesize_lfe() {
+		T *d = &dst[(C-1)*N];
+		const unsigned M = N/lfe_decimation;
+		dst_clear[C-1] = false;
+		if (!lfe_fft || cur.hi_cut > M/16) {
+			fft->inverse(&signal[C-1][0],d);
+			return;
+		}
+		lfe_fft->inverse(&signal[C-1][0],&lfe_dec[0]);
+		// (only the part covered by the synthesis window, from S on, is needed; the block is periodic in M)
+		for (unsigned m=S/lfe_decimation;m<M;m++) {
+			vec x[lfe_taps];
+			for (int i=0;i<lfe_taps;i++)
+				x[i] = lfe_dec[(m+M+i-2)%M];
+			for (unsigned j=0;j<lfe_decimation;j+=W) {
+				vec y = 0, w;
+				for (int i=0;i<lfe_taps;i++) {
+					simd::load(w,&lfe_interp[i*lfe_decimation+j]);
+					y = y + w*x[i];
+				}
+				simd::store(&d[m*lfe_decimation+j],y);
+			}
+		}
+	}
+
+	// whether the soundfield positions need to be computed for this block: every interval hops, when they are
+	// out of date, or when the magnitude spectra have changed by more than the flux threshold since they were
+	bool steering_due() {
+		if (interval == 1)
+			return true;
+		bool due = steer_pending || ++since_steering >= interval;
+		if (!mag.empty()) {
+			// the relative change of the magnitudes of both sides (the current ones go into the second half of mag,
+			// and become the reference when steering)
+			T *ref = &mag[0], *latest = &mag[2*bins];
+			vec diff = 0, total = 0;
+			for (unsigned f=0;f<bins;f+=W) {
+				vec lr,li,rr,ri,ml,mr,ol,orr;
+				simd::load(lr,&lre[f]); simd::load(li,&lim[f]);
+				simd::load(rr,&rre[f]); simd::load(ri,&rim[f]);
+				simd::load(ol,&ref[f]); simd::load(orr,&ref[bins+f]);
+				ml = simd::sqrt(lr*lr + li*li); mr = simd::sqrt(rr*rr + ri*ri);
+				diff = diff + simd::abs(ml-ol) + simd::abs(mr-orr);
+				total = total + ol + orr;
+				simd::store(&latest[f],ml); simd::store(&latest[bins+f],mr);
+			}
+			T d[W], t[W], flux = 0, level = 0;
+			simd::store(d,diff); simd::store(t,total);
+			for (unsigned j=0;j<W;j++) {
+				flux += d[j];
+				level += t[j];
+			}
+			due = due || flux > flux_threshold*level;
+			if (due)
+				std::copy(latest,latest+2*bins,ref);
+		}
+		if (due) {
+			since_steering = 0;
+			steer_pending = false;
+		}
+		return due;
+	}
+
+	// compute soundfield position, total amplitude and L/C/R phasors of the bins [f,f+W) (W = width of V)
+	template<class V, bool positions=true> void steer(unsigned f) {
+		V lr,li,rr,ri;
+		simd::load(lr,&lre[f]); simd::load(li,&lim[f]);
+		simd::load(rr,&rre[f]); simd::load(ri,&rim[f]);
+
+		// get Lt/Rt amplitudes
+		V ampL = simd::sqrt(lr*lr + li*li), ampR = simd::sqrt(rr*rr + ri*ri);
+		// calculate the phase difference and the total L/C/R signal phases, as unit phasors
+		V phaseDiff, ur[3], ui[3];
+		if (reference_phases) {
+			// via the absolute phase angles
+			V phaseL = simd::atan2(li,lr), phaseR = simd::atan2(ri,rr);
+			phaseDiff = simd::abs(phaseL - phaseR);
+			phaseDiff = simd::select(phaseDiff > pi,2*pi - phaseDiff,phaseDiff);
+			V phase_of[] = {phaseL,simd::atan2(li+ri,lr+rr),phaseR};
+			for (unsigned k=0;k<3;k++)
+				simd::sincos(phase_of[k],ui[k],ur[k]);
+		} else {
+			// directly from the spectra: the phase difference is the angle of L*conj(R),
+			// and the phasors are the normalized L, L+R and R spectra
+			if (positions)
+				phaseDiff = simd::atan2(simd::abs(li*rr - lr*ri),lr*rr + li*ri);
+			unit_phasor(lr,li,ampL,ur[0],ui[0]);
+			unit_phasor(lr+rr,li+ri,simd::sqrt((lr+rr)*(lr+rr) + (li+ri)*(li+ri)),ur[1],ui[1]);
+			unit_phasor(rr,ri,ampR,ur[2],ui[2]);
+			// a side that is silent up to rounding noise (e.g., from the packed FFT) carries no phase information;
+			// it is taken to be in phase with the other side
+			V level = epsilon*simd::max(ampL,ampR), silentL = ampL < level, silentR = ampR < level;
+			if (positions)
+				phaseDiff = simd::select(simd::mask_or(silentL,silentR),V(0),phaseDiff);
+			ur[0] = simd::select(silentL,ur[1],ur[0]); ui[0] = simd::select(silentL,ui[1],ui[0]);
+			ur[2] = simd::select(silentR,ur[1],ur[2]); ui[2] = simd::select(silentR,ui[1],ui[2]);
+		}
+
+		// get the x/y soundfield position (unless steering by bands)
+		if (positions)
+			locate(ampL,ampR,phaseDiff,&gp[f],&gq[f],&gx[f],&gy[f]);
+
+		// get total signal amplitude
+		simd::store(&amp[f],simd::sqrt(ampL*ampL + ampR*ampR));
+		// and the phasors
+		for (unsigned k=0;k<3;k++) {
+			simd::store(&ure[k][f],ur[k]); simd::store(&uim[k][f],ui[k]);
+		}
+	}
+
+	// map amp/phase differences to the final soundfield position (decoding followed by all soundfield transformations)
+	template<class V> static void transform_position(const parameters &cur, V ampDiff, V phaseDiff, V &x, V &y) {
+		// decode into x/y soundfield position
+		transform_decode(ampDiff,phaseDiff,x,y);
+		// add wrap control
+		if (cur.circular_wrap != 90)
+			per_lane(x,y,[&](double &x, double &y) { transform_circular_wrap(x,y,cur.circular_wrap); });
+		// add shift control
+		y = clamp(y - cur.shift);
+		// add depth control
+		y = clamp(1 - (1-y)*cur.depth);
+		// add focus control
+		if (cur.focus != 0)
+			per_lane(x,y,[&](double &x, double &y) { transform_focus(x,y,cur.focus); });
+		// add crossfeed control
+		x = clamp(x * (cur.front_separation*(1+y)/2 + cur.rear_separation*(1-y)/2));
+	}
+
+	// tabulate transform_position over res x res points of the (ampDiff, phaseDiff) plane
+	static void tabulate_positions(const parameters &p, unsigned res, vector<T> &table) {
+		table.resize(2*res*res);
+		for (unsigned i=0;i<res;i++) {
+			for (unsigned j=0;j<res;j++) {
+				T x,y;
+				transform_position<T>(p,T(2.0*j/(res-1)-1),T(pi*i/(res-1)),x,y);
+				table[2*(i*res+j)+0] = x;
+				table[2*(i*res+j)+1] = y;
+			}
+		}
+	}
+
+	void build_steering_lut() {
+		tabulate_positions(cur,lut_res,lut);
+		lut_dirty = false;
+	}
+
+	// look up the soundfield position in a steering table of the given resolution (with bilinear interpolation)
+	template<class V> static void lookup_position(const vector<T> &table, unsigned res, V ampDiff, V phaseDiff, V &x, V &y) {
+		enum { L = simd::lanes<V>::width };
+		// get the cell of the table and the fractional offsets within it
+		V u = (ampDiff+1)*(0.5f*(res-1)), v = phaseDiff*((res-1)/pi);
+		V j = simd::min(V(res-2),simd::floor(u)), i = simd::min(V(res-2),simd::floor(v));
+		u = u-j; v = v-i;
+		T is[L],js[L],x00[L],x01[L],x10[L],x11[L],y00[L],y01[L],y10[L],y11[L];
+		simd::store(is,i); simd::store(js,j);
+		for (unsigned k=0;k<L;k++) {
+			const T *e = &table[2*((unsigned)is[k]*res + (unsigned)js[k])], *e1 = e + 2*res;
+			x00[k] = e[0]; y00[k] = e[1]; x01[k] = e[2]; y01[k] = e[3];
+			x10[k] = e1[0]; y10[k] = e1[1]; x11[k] = e1[2]; y11[k] = e1[3];
+		}
+		V v00,v01,v10,v11;
+		simd::load(v00,x00); simd::load(v01,x01); simd::load(v10,x10); simd::load(v11,x11);
+		x = clamp((1-u)*(1-v)*v00 + u*(1-v)*v01 + (1-u)*v*v10 + u*v*v11);
+		simd::load(v00,y00); simd::load(v01,y01); simd::load(v10,y10); simd::load(v11,y11);
+		y = clamp((1-u)*(1-v)*v00 + u*(1-v)*v01 + (1-u)*v*v10 + u*v*v11);
+	}
+
+	// get the soundfield position from the amplitudes and the phase difference of the two sides, either from the
+	// steering table or analytically, and store its 2d channel map indexes p/q and the fractional offsets x/y in
+	// the map grid
+	template<class V> void locate(V ampL, V ampR, V phaseDiff, T *p, T *q, T *gx, T *gy) {
+		// calculate the amplitude difference
+		V ampDiff = clamp(simd::select(ampL+ampR < epsilon,V(0),(ampR-ampL) / (ampR+ampL)));
+		V x,y;
+		if (lut_res)
+			lookup_position(lut,lut_res,ampDiff,phaseDiff,x,y);
+		else
+			transform_position(cur,ampDiff,phaseDiff,x,y);
+		simd::store(p,map_to_grid(x)); simd::store(q,map_to_grid(y));
+		simd::store(gx,x); simd::store(gy,y);
+	}
+
+	// compute the soundfield position of every steering band from the power of both sides and their cross-spectrum,
+	// summed over the band, and the channel volumes there (per unit of amplitude)
+	void steer_bands() {
+		for (unsigned b=0;b<bands;b++) {
+			T el = 0, er = 0, cr = 0, ci = 0;
+			for (unsigned f=band_start[b];f<band_start[b+1];f++) {
+				el += lre[f]*lre[f] + lim[f]*lim[f];
+				er += rre[f]*rre[f] + rim[f]*rim[f];
+				cr += lre[f]*rre[f] + lim[f]*rim[f];
+				ci += lim[f]*rre[f] - lre[f]*rim[f];
+			}
+			bel[b] = el; ber[b] = er; bcr[b] = cr; bci[b] = ci;
+		}
+		for (unsigned b=0;b<bands;b+=W) {
+			vec el,er,cr,ci;
+			simd::load(el,&bel[b]); simd::load(er,&ber[b]); simd::load(cr,&bcr[b]); simd::load(ci,&bci[b]);
+			vec ampL = simd::sqrt(el), ampR = simd::sqrt(er), level = epsilon*simd::max(ampL,ampR);
+			// (as per bin, a side that is silent up to rounding noise is taken to be in phase with the other)
+			vec phaseDiff = simd::select(simd::mask_or(ampL < level,ampR < level),vec(0),simd::atan2(simd::abs(ci),cr));
+			locate(ampL,ampR,phaseDiff,&bgp[b],&bgq[b],&bgx[b],&bgy[b]);
+		}
+		const unsigned row = grid_res*CP;
+		for (unsigned b=0;b<bands;b++) {
+			const T *a = &alloc[((unsigned)bgq[b]*grid_res + (unsigned)bgp[b])*CP];
+			T x = bgx[b], y = bgy[b];
+			vec w00 = (1-x)*(1-y), w01 = x*(1-y), w10 = (1-x)*y, w11 = x*y;
+			for (unsigned c=0;c<CP;c+=W) {
+				vec v00,v01,v10,v11;
+				simd::load(v00,a+c); simd::load(v01,a+CP+c); simd::load(v10,a+row+c); simd::load(v11,a+row+CP+c);
+				simd::store(&bvol[b*CP+c],w00*v00 + w01*v01 + w10*v10 + w11*v11);
+			}
+		}
+		// (the bins above the last band center take its volumes as they are)
+		std::copy(&bvol[(bands-1)*CP],&bvol[bands*CP],&bvol[bands*CP]);
+	}
+
+	// interpolate the channel volumes of bin f between those of the enclosing bands, and build the signal of each
+	// of the channels [c0,c1) from the phasor of its side
+	void synthesize_banded(unsigned f, unsigned c0, unsigned c1) {
+		const T *a = &bvol[band_of[f]*CP];
+		vec w1 = band_frac[f], w0 = 1-band_frac[f], total = amp[f];
+		alignas(64) T fixed_vol[NC ? (NC-1+W-1)/W*W : 1];
+		T *v = NC ? fixed_vol : &vol[0];
+		for (unsigned c=c0;c<c1;c+=W) {
+			vec v0,v1;
+			simd::load(v0,a+c); simd::load(v1,a+CP+c);
+			vec vc = total*(w0*v0 + w1*v1), pc;
+			simd::store(&v[c],vc);
+			simd::load(pc,&power[c]);
+			simd::store(&power[c],pc + vc*vc);
+		}
+		const cplx u[3] = {cplx(ure[0][f],uim[0][f]),cplx(ure[1][f],uim[1][f]),cplx(ure[2][f],uim[2][f])};
+		for (unsigned c=c0;c<c1 && c<C-1;c++)
+			signal[c][f] = v[c]*u[side[c]];
+	}
+
+	// look up the allocation table at the position of bin f (with bilinear interpolation, for the channels [c0,c1)
+	// at once) and build each one's signal from the phasor of its side
+	void synthesize(unsigned f, unsigned c0, unsigned c1) {
+		const T *a = &alloc[((unsigned)gq[f]*grid_res + (unsigned)gp[f])*CP];
+		const unsigned row = grid_res*CP;
+		T x = gx[f], y = gy[f];
+		vec w00 = (1-x)*(1-y), w01 = x*(1-y), w10 = (1-x)*y, w11 = x*y, total = amp[f];
+		// (with a fixed number of channels the volumes stay in registers)
+		alignas(64) T fixed_vol[NC ? (NC-1+W-1)/W*W : 1];
+		T *v = NC ? fixed_vol : &vol[0];
+		for (unsigned c=c0;c<c1;c+=W) {
+			vec v00,v01,v10,v11;
+			simd::load(v00,a+c); simd::load(v01,a+CP+c); simd::load(v10,a+row+c); simd::load(v11,a+row+CP+c);
+			vec vc = total*(w00*v00 + w01*v01 + w10*v10 + w11*v11), pc;
+			simd::store(&v[c],vc);
+			simd::load(pc,&power[c]);
+			simd::store(&power[c],pc + vc*vc);
+		}
+		const cplx u[3] = {cplx(ure[0][f],uim[0][f]),cplx(ure[1][f],uim[1][f]),cplx(ure[2][f],uim[2][f])};
+		for (unsigned c=c0;c<c1 && c<C-1;c++)
+			signal[c][f] = v[c]*u[side[c]];
+	}
+
 	// transform amp/phase difference space into x/y soundfield space
-	void transform_decode(double a, double p, double &x, double &y) {
+	template<class V> static void transform_decode(V a, V p, V &x, V &y) {
 		x = clamp(1.0047*a + 0.46804*a*p*p*p - 0.2042*a*p*p*p*p + 0.0080586*a*p*p*p*p*p*p*p - 0.0001526*a*p*p*p*p*p*p*p*p*p*p
 			- 0.073512*a*a*a*p - 0.2499*a*a*a*p*p*p*p + 0.016932*a*a*a*p*p*p*p*p*p*p - 0.00027707*a*a*a*p*p*p*p*p*p*p*p*p*p
 			+ 0.048105*a*a*a*a*a*p*p*p*p*p*p*p - 0.0065947*a*a*a*a*a*p*p*p*p*p*p*p*p*p*p + 0.0016006*a*a*a*a*a*p*p*p*p*p*p*p*p*p*p*p
@@ -200,7 +1245,7 @@ private:
 	}
 
 	// apply a circular_wrap transformation to some position
-	void transform_circular_wrap(double &x, double &y, double refangle) {
+	static void transform_circular_wrap(double &x, double &y, double refangle) {
 		if (refangle == 90)
 			return;
 		refangle = refangle*pi/180;
@@ -222,7 +1267,7 @@ private:
 	}
 
 	// apply a focus transformation to some position
-	void transform_focus(double &x, double &y, double focus) {
+	static void transform_focus(double &x, double &y, double focus) {
 		if (focus == 0)
 			return;
 		// translate into edge-normalized polar coordinates
@@ -236,38 +1281,498 @@ private:
 	}
 
 	// constants
-	unsigned N,C;					// number of samples per input/output block, number of output channels
+	unsigned N;						// number of samples per input/output block
+	channel_count<NC> C;			// number of output channels
 	channel_setup setup;			// the channel setup
 
 	// parameters
-	float circular_wrap;			// angle of the front soundstage around the listener (90�=default)
-	float shift;					// forward/backward offset of the soundstage
-	float depth;					// backward extension of the soundstage
-	float focus;					// localization of the sound events
-	float center_image;				// presence of the center speaker
-	float front_separation;			// front stereo separation
-	float rear_separation;			// rear stereo separation
-	float lo_cut, hi_cut;			// LFE cutoff frequencies
-	bool use_lfe;					// whether to use the LFE channel
+	parameters cur;					// in effect for the current hop
+	parameters target;				// last picked up, reached at the end of the ramp
+	unsigned ramp;					// number of hops left until the target is reached
+	bool reference_phases;			// whether to compute the signal phases via atan2/sincos
+	float silence_threshold;		// input level up to which a sample counts as silent
+	float sparsity_threshold;		// share of the block's power up to which a channel is not transformed back
+	T sparse_level;					// power up to which a channel is not transformed back in the current block
+	std::unique_ptr<worker_pool> pool; // threads that share the work of each hop (none: all in the decoding thread)
+
+	// publication of parameter changes (see publish())
+	enum { fresh = 4 };				// mailbox flag: the slot has not been picked up yet
+	std::atomic<unsigned> mailbox;	// slot last published (| fresh)
+	unsigned front, back;			// slots owned by the decoding thread and by the control side
+	parameters slots[3];			// the triple buffer
+	parameters staging;				// the control side's copy of the parameters
+	std::mutex control;				// serializes the control threads
+
+	// the arena that holds the buffers below (see layout())
+	char *arena;
+	size_t arena_size;
+	bool own_arena;					// whether it was allocated by the decoder (rather than given by the caller)
+
+	// tables shared with other decoders
+	std::shared_ptr<const window_tables<T> > windows; // the window functions in use
+	std::shared_ptr<const setup_tables<T> > channel_tables; // the tables of the channel setup
 
 	// FFT data structures
-	vector<double> lt,rt,dst;		// left total, right total (source arrays), time-domain destination buffer array
-	vector<cplx> lf,rf;				// left total / right total in frequency domain
-	kiss_fftr_cfg forward,inverse;	// FFT buffers
+	const T *wnd2;					// the analysis window function, duplicated for multiplexed stereo (from windows)
+	cplx *zt,*zf;					// left total + i * right total, in time and frequency domain
+	T *dst;							// time-domain destination buffer, per channel
+	bool *dst_clear;				// per channel: whether its destination holds zeros (from S on)
+	unsigned H;						// hop size, in samples (N/2 by default)
+	unsigned S;						// start of the synthesis window within a block (0 unless in low-latency mode)
+	std::shared_ptr<fft_backend<T> > fft; // FFT implementation
+
+	// LFE synthesis
+	enum { lfe_decimation = 16, lfe_taps = 6 };
+	double *lfe_xover;				// level of the LFE channel per bin (up to hi_cut)
+	float xover_lo, xover_hi;		// the cutoffs that lfe_xover was built for
+	std::shared_ptr<fft_backend<T> > lfe_fft; // inverse transform of N/lfe_decimation points (none if too small)
+	T *lfe_dec;						// decimated LFE block
+	const T *lfe_interp;			// interpolation weights, [tap][phase] (see lfe_weights())
+
+	// per-bin steering data, as structure-of-arrays (padded to a multiple of W)
+	unsigned bins;					// number of bins processed (N/2+1, rounded up)
+	T *lre,*lim,*rre,*rim;		// left total / right total spectra, split into real & imaginary parts
+	T *amp;						// total signal amplitude
+	T *gp,*gq;					// cell of the channel allocation grid
+	T *gx,*gy;					// fractional offsets within that cell
+	T *ure[3],*uim[3];			// unit phasors of the L/C/R signal phases
+	T *phasors;					// (which are stored here)
+
+	// steering table (optional)
+	unsigned lut_res;				// resolution of the table along each axis (0 = evaluate the transformations per bin)
+	bool lut_dirty;					// whether the table needs to be rebuilt before the next block
+	vector<T> lut;					// soundfield x/y positions, [phaseDiff][ampDiff][2]
+
+	// temporal decimation of the steering (optional)
+	unsigned interval;				// maximum number of hops between two steered ones (1 = steer every hop)
+	float flux_threshold;			// relative spectral flux beyond which a hop is steered anyway (0 = none)
+	unsigned since_steering;		// number of hops since the last steered one
+	bool steer_pending;				// whether the positions are out of date (parameters changed, shortcut hops, ...)
+	vector<T> mag;					// magnitude spectra (left, right) at the last steered hop, and at the current one
+
+	// steering bands (optional)
+	unsigned bands;					// number of bands (0 = steer every bin)
+	vector<unsigned> band_start;	// first bin of each band (and the end of the last one)
+	vector<T> bel,ber,bcr,bci;		// per band: power of the left and right total, real & imaginary part of L*conj(R)
+	vector<T> bgp,bgq,bgx,bgy;		// per band: cell of the channel allocation grid and the offsets within it
+	vector<T,simd::allocator<T> > bvol; // per band: channel volumes, [band][channel] (the last band repeated)
+	vector<unsigned> band_of;		// per bin: the band whose center is at or below it
+	vector<T> band_frac;			// per bin: its relative distance from that center to the next
+
+	// channel allocation
+	channel_count<NC?(NC-1+W-1)/W*W:0> CP; // number of channels in the allocation table (C-1, rounded up to a multiple of W)
+	T *alloc;						// channel allocation table, [q][p][channel] (with the center image folded in)
+	float folded_center_image;		// the center image setting that alloc reflects
+	T *vol;							// volumes of the channels at the current bin
+	T *power;						// power of each channel in the current block
+	const unsigned *side;			// side (0=L, 1=C, 2=R) whose phase each channel takes (from channel_tables)
 
 	// buffers
 	bool buffer_empty;				// whether the buffer is currently empty or dirty
-	vector<float> inbuf;			// stereo input buffer (multiplexed)
-	vector<float> outbuf;			// multichannel output buffer (multiplexed)
-	vector<double> wnd;				// the window function, precomputed
-	vector<vector<cplx> > signal;	// the signal to be constructed in every channel, in the frequency domain
+	float *inbuf;					// stereo input ring (multiplexed), holding the last N-H samples of the previous call and the first N-H of this one
+	size_t in_pos;					// position in the ring where the next sample goes
+	float *outbuf;					// multichannel output buffer for decode() (multiplexed)
+	float **chp;					// where each channel's output goes (for multiplexed output)
+	unsigned quiet_run, mono_run;	// number of silent / mono input samples up to the end of the last block (up to N)
+	size_t hops[4];					// number of hops that took each path
+	float *tail;					// the last N-H samples of the previous hop's output, partially overlap-added (multiplexed)
+	const T *wnd;					// the synthesis window function, precomputed (from windows)
+	cplx **signal;					// the signal to be constructed in every channel, in the frequency domain (N/2+1 bins)
+	cplx *spectra;					// (which is stored here, [channel][bin], bins per channel)
+};
+
+
+// create the implementation for a channel setup; the common setups get a decoder that is specialized for their
+// number of channels, unless the generic one is asked for (see freesurround_decoder::create_generic())
+template<class T> decoder_base *create_decoder(channel_setup setup, unsigned N, void *mem, size_t lenmem, bool generic) {
+	if (!generic) {
+		switch (setup) {
+		case cs_stereo: return new decoder_impl<T,3>(setup,N,mem,lenmem);
+		case cs_3stereo: return new decoder_impl<T,4>(setup,N,mem,lenmem);
+		case cs_4point1: return new decoder_impl<T,5>(setup,N,mem,lenmem);
+		case cs_5point1: return new decoder_impl<T,6>(setup,N,mem,lenmem);
+		case cs_7point1: return new decoder_impl<T,8>(setup,N,mem,lenmem);
+		default: break;
+		}
+	}
+	return new decoder_impl<T>(setup,N,mem,lenmem);
+}
+
+
+// interface of the multi-stream implementation (independent of the working precision)
+class multi_decoder_base {
+public:
+	virtual ~multi_decoder_base() { }
+	virtual size_t decode_many(const float *const *inputs, size_t frames, float *const *outputs) = 0;
+	virtual void flush() = 0;
+	virtual void set_circular_wrap(float v) = 0;
+	virtual void set_shift(float v) = 0;
+	virtual void set_depth(float v) = 0;
+	virtual void set_focus(float v) = 0;
+	virtual void set_center_image(float v) = 0;
+	virtual void set_front_separation(float v) = 0;
+	virtual void set_rear_separation(float v) = 0;
+	virtual void set_channel_mask(unsigned ids) = 0;
+	virtual void set_low_cutoff(float v) = 0;
+	virtual void set_high_cutoff(float v) = 0;
+	virtual void set_bass_redirection(bool v) = 0;
+	virtual bool set_fft_implementation(const char *name) = 0;
+	virtual unsigned latency() = 0;
+};
+
+// FreeSurround implementation for W independent streams (W = width of the SIMD pack of T), one per lane: each
+// spectral and time-domain buffer holds a pack per value, with the same value of every stream in it, so the
+// transforms and the steering run on packs just as decoder_impl runs them on W adjacent bins, and each stream is
+// decoded exactly as decoder_impl decodes it on its full path (with the default processing options); only the
+// lookups of the channel allocation table go lane by lane
+template<class T> class multi_decoder_impl: public multi_decoder_base {
+	typedef decoder_impl<T> scalar;
+	typedef typename scalar::vec vec;
+	typedef typename scalar::parameters parameters;
+	enum { W = scalar::W, lfe_decimation = scalar::lfe_decimation, lfe_taps = scalar::lfe_taps };
+public:
+	multi_decoder_impl(channel_setup setup, unsigned N): N(N), H(N/2), C((unsigned)chn_alloc[setup].size()),
+		CP((C-1+W-1)/W*W), setup(setup), ramp(0), fresh(true), buffer_empty(true), fft(shared_lane_transforms<vec>(N)),
+		inbuf(2*3*N), zt(2*N), zf(2*N), spectra(C*(N+2)), dst(C*N), dst_clear(C,false), lfe_dec(N/lfe_decimation),
+		tail(C*H), power(C)
+	{
+		windows = scalar::window_functions(N,H,N);
+		wnd2 = &windows->wnd2[0];
+		wnd = &windows->wnd[0];
+		channel_tables = scalar::channel_setup_tables(setup,C);
+		side = &channel_tables->side[0];
+		alloc = channel_tables->alloc;
+		folded_center_image = 1;
+		lfe_xover.resize(N/2);
+		xover_lo = xover_hi = -1;
+		if (N/lfe_decimation >= 16)
+			lfe_fft = shared_lane_transforms<vec>(N/lfe_decimation);
+		lfe_interp = scalar::lfe_weights();
+
+		// set default parameters (as those of decoder_impl)
+		set_circular_wrap(90);
+		set_shift(0);
+		set_depth(1);
+		set_focus(0);
+		set_center_image(1);
+		set_front_separation(1);
+		set_rear_separation(1);
+		set_channel_mask(~0u);
+		set_low_cutoff(40.0/22050);
+		set_high_cutoff(90.0/22050);
+		set_bass_redirection(false);
+		flush();
+	}
+
+	// decode all whole hops of the W stereo inputs, writing the (lagged) multichannel output of each (multiplexed)
+	size_t decode_many(const float *const *inputs, size_t frames, float *const *outputs) {
+		simd::flush_denormals ftz;
+		frames -= frames % H;
+		for (size_t p=0;p<frames;p+=H) {
+			append(inputs,p,H);
+			// (the block is the last N frames in the ring)
+			buffered_decode(&inbuf[2*((in_pos+N)%(2*N))],outputs,p);
+		}
+		if (frames)
+			buffer_empty = false;
+		return frames;
+	}
+
+	// flush the internal buffers
+	void flush() {
+		std::fill(inbuf.begin(),inbuf.end(),vec(0));
+		std::fill(tail.begin(),tail.end(),vec(0));
+		in_pos = 0;
+		buffer_empty = true;
+	}
+
+	// delay of the output relative to the input
+	unsigned latency() { return N-H; }
+
+	// set soundfield & rendering parameters (picked up at the next hop, and ramped in as by decoder_impl)
+	void set_circular_wrap(float v) { staging.circular_wrap = v; fresh = true; }
+	void set_shift(float v) { staging.shift = v; fresh = true; }
+	void set_depth(float v) { staging.depth = v; fresh = true; }
+	void set_focus(float v) { staging.focus = v; fresh = true; }
+	void set_center_image(float v) { staging.center_image = v; fresh = true; }
+	void set_front_separation(float v) { staging.front_separation = v; fresh = true; }
+	void set_rear_separation(float v) { staging.rear_separation = v; fresh = true; }
+	void set_channel_mask(unsigned ids) { staging.channels = ids; fresh = true; }
+	void set_low_cutoff(float v) { staging.lo_cut = v*(N/2); fresh = true; }
+	void set_high_cutoff(float v) { staging.hi_cut = v*(N/2); fresh = true; }
+	void set_bass_redirection(bool v) { staging.lfe = v; fresh = true; }
+	bool set_fft_implementation(const char *name) {
+		std::shared_ptr<fft_lane_backend<vec> > f = shared_lane_transforms<vec>(N,name);
+		if (!f)
+			return false;
+		fft = f;
+		return true;
+	}
+
+private:
+	// append frames [p,p+n) of the inputs to the input ring (2N frames of a left and a right pack, whose first N
+	// are mirrored behind its end); a missing input is silent
+	void append(const float *const *inputs, size_t p, size_t n) {
+		T l[W], r[W];
+		for (size_t k=p;k<p+n;k++) {
+			for (unsigned s=0;s<W;s++) {
+				l[s] = inputs[s] ? inputs[s][2*k] : 0;
+				r[s] = inputs[s] ? inputs[s][2*k+1] : 0;
+			}
+			simd::load(inbuf[2*in_pos],l);
+			simd::load(inbuf[2*in_pos+1],r);
+			if (in_pos < N) {
+				inbuf[2*(in_pos+2*N)] = inbuf[2*in_pos];
+				inbuf[2*(in_pos+2*N)+1] = inbuf[2*in_pos+1];
+			}
+			in_pos = (in_pos+1) % (2*N);
+		}
+	}
+
+	// at the start of each hop: pick up changed parameters, and move the current ones a step towards them
+	void update_parameters() {
+		if (fresh) {
+			target = staging;
+			fresh = false;
+			ramp = buffer_empty ? 1 : N/H;
+			cur.channels = target.channels;
+		}
+		if (ramp) {
+			for (auto field : scalar::ramped)
+				cur.*field = ramp == 1 ? target.*field : cur.*field + (target.*field - cur.*field)/ramp;
+			ramp--;
+			if (cur.center_image != folded_center_image) {
+				scalar::fold_center_image(*channel_tables,CP,cur.center_image,&alloc[0]);
+				folded_center_image = cur.center_image;
+			}
+			if (cur.lo_cut != xover_lo || cur.hi_cut != xover_hi) {
+				scalar::crossover(N,cur.lo_cut,cur.hi_cut,&lfe_xover[0]);
+				xover_lo = cur.lo_cut;
+				xover_hi = cur.hi_cut;
+			}
+			// the LFE range may have shrunk
+			std::fill(&spectra[(C-1)*(N+2)],&spectra[C*(N+2)],vec(0));
+		}
+	}
+
+	// decode a block and overlap-add it with the tail of the previous one, producing H samples of each stream
+	// (starting at frame pos of the outputs)
+	void buffered_decode(const vec *input, float *const *outputs, size_t pos) {
+		update_parameters();
+		render(input);
+		// with 50% overlap, the first half of the block completes the output together with the tail, and the second
+		// half becomes the next tail (which is kept in single precision, as in decoder_impl)
+		T y[W];
+		for (unsigned k=0;k<H;k++) {
+			const T w0 = wnd[k], w1 = wnd[k+H];
+			vec *t = &tail[C*k];
+			for (unsigned c=0;c<C;c++) {
+				simd::store(y,t[c] + w0*dst[c*N+k]);
+				for (unsigned s=0;s<W;s++)
+					if (outputs[s])
+						outputs[s][(pos+k)*C+c] = (float)y[s];
+				t[c] = simd::round_float(w1*dst[c*N+k+H]);
+			}
+		}
+	}
+
+	// render a block through the spectral domain: analysis, steering and synthesis of every channel
+	void render(const vec *input) {
+		// apply the window function (left total into the real, right total into the imaginary parts)
+		for (unsigned k=0;k<2*N;k++)
+			zt[k] = wnd2[k]*input[k];
+		fft->forward(&zt[0],&zf[0]);
+
+		// steer every bin and build each channel's spectrum from it, summing up the power of each channel
+		std::fill(power.begin(),power.end(),vec(0));
+		for (unsigned f=1;f<N/2;f++)
+			steer_and_synthesize(f);
+		for (unsigned c=0;c<C-1;c++)
+			signal(c)[0] = signal(c)[1] = signal(c)[N] = signal(c)[N+1] = 0;
+
+		// back-transform each channel, except for those that are muted or carry (next to) nothing in this block, in
+		// any stream (the streams in which a channel carries next to nothing get silence, as in decoder_impl)
+		vec total = 0;
+		for (unsigned c=0;c<C-1;c++)
+			total = total + power[c];
+		for (unsigned c=0;c<C-1;c++) {
+			vec keep = power[c] > vec(sparsity_threshold)*total;
+			T kept[W];
+			simd::store(kept,simd::select(keep,vec(1),vec(0)));
+			unsigned count = 0;
+			for (unsigned s=0;s<W;s++)
+				count += kept[s] != 0;
+			if (!rendered(c) || !count) {
+				clear(c);
+				continue;
+			}
+			if (count < W) {
+				for (unsigned f=0;f<N+2;f++)
+					signal(c)[f] = simd::select(keep,signal(c)[f],vec(0));
+			}
+			fft->inverse(signal(c),&dst[c*N]);
+			dst_clear[c] = false;
+		}
+		if (rendered(C-1) && cur.lfe > 0)
+			synthesize_lfe();
+		else
+			clear(C-1);
+	}
+
+	// separate and steer bin f of all streams (as decoder_impl::steer()), look up the channel volumes there, and
+	// redirect its bass into the LFE channel
+	void steer_and_synthesize(unsigned f) {
+		// (L = (Z[f] + Z*[N-f])/2, R = (Z[f] - Z*[N-f])/2i)
+		const vec ar = zf[2*f], ai = zf[2*f+1], br = zf[2*(N-f)], bi = zf[2*(N-f)+1];
+		const vec lr = (ar + br)*T(0.5), li = (ai - bi)*T(0.5), rr = (ai + bi)*T(0.5), ri = (br - ar)*T(0.5);
+		vec ampL = simd::sqrt(lr*lr + li*li), ampR = simd::sqrt(rr*rr + ri*ri);
+		vec phaseDiff = simd::atan2(simd::abs(li*rr - lr*ri),lr*rr + li*ri), ur[3], ui[3];
+		scalar::unit_phasor(lr,li,ampL,ur[0],ui[0]);
+		scalar::unit_phasor(lr+rr,li+ri,simd::sqrt((lr+rr)*(lr+rr) + (li+ri)*(li+ri)),ur[1],ui[1]);
+		scalar::unit_phasor(rr,ri,ampR,ur[2],ui[2]);
+		vec level = epsilon*simd::max(ampL,ampR), silentL = ampL < level, silentR = ampR < level;
+		phaseDiff = simd::select(simd::mask_or(silentL,silentR),vec(0),phaseDiff);
+		ur[0] = simd::select(silentL,ur[1],ur[0]); ui[0] = simd::select(silentL,ui[1],ui[0]);
+		ur[2] = simd::select(silentR,ur[1],ur[2]); ui[2] = simd::select(silentR,ui[1],ui[2]);
+
+		// the soundfield position, and the cell of the allocation table and the offsets within it
+		vec ampDiff = scalar::clamp(simd::select(ampL+ampR < epsilon,vec(0),(ampR-ampL) / (ampR+ampL))), x, y;
+		scalar::transform_position(cur,ampDiff,phaseDiff,x,y);
+		T p[W], q[W];
+		simd::store(p,scalar::map_to_grid(x));
+		simd::store(q,scalar::map_to_grid(y));
+		const vec total = simd::sqrt(ampL*ampL + ampR*ampR);
+		const vec w00 = (1-x)*(1-y), w01 = x*(1-y), w10 = (1-x)*y, w11 = x*y;
+
+		// interpolate the volumes of each channel (gathering the table entries of each stream), and build its signal
+		// from the phasor of its side
+		const T *a[W];
+		for (unsigned s=0;s<W;s++)
+			a[s] = &alloc[((unsigned)q[s]*grid_res + (unsigned)p[s])*CP];
+		const unsigned row = grid_res*CP;
+		for (unsigned c=0;c<C-1;c++) {
+			T e00[W], e01[W], e10[W], e11[W];
+			for (unsigned s=0;s<W;s++) {
+				e00[s] = a[s][c]; e01[s] = a[s][CP+c]; e10[s] = a[s][row+c]; e11[s] = a[s][row+CP+c];
+			}
+			vec v00,v01,v10,v11;
+			simd::load(v00,e00); simd::load(v01,e01); simd::load(v10,e10); simd::load(v11,e11);
+			const vec vc = total*(w00*v00 + w01*v01 + w10*v10 + w11*v11);
+			power[c] = power[c] + vc*vc;
+			signal(c)[2*f] = vc*ur[side[c]];
+			signal(c)[2*f+1] = vc*ui[side[c]];
+		}
+
+		// optionally redirect bass (the LFE level is computed in double precision, as in decoder_impl)
+		if (cur.lfe > 0 && f < cur.hi_cut) {
+			const double lfe_level = cur.lfe * lfe_xover[f];
+			T amp[W], re[W], im[W];
+			simd::store(amp,total); simd::store(re,ur[1]); simd::store(im,ui[1]);
+			for (unsigned s=0;s<W;s++) {
+				const T g = T(lfe_level * amp[s]);
+				re[s] = g*re[s];
+				im[s] = g*im[s];
+			}
+			simd::load(signal(C-1)[2*f],re);
+			simd::load(signal(C-1)[2*f+1],im);
+			const vec rest = T(1-lfe_level);
+			for (unsigned c=0;c<C-1;c++) {
+				signal(c)[2*f] = signal(c)[2*f]*rest;
+				signal(c)[2*f+1] = signal(c)[2*f+1]*rest;
+			}
+		}
+	}
+
+	// back-transform the LFE channel, through the decimated transform while its spectrum is low enough (see
+	// decoder_impl::synthesize_lfe())
+	void synthesize_lfe() {
+		vec *d = &dst[(C-1)*N];
+		const unsigned M = N/lfe_decimation;
+		dst_clear[C-1] = false;
+		if (!lfe_fft || cur.hi_cut > M/16) {
+			fft->inverse(signal(C-1),d);
+			return;
+		}
+		lfe_fft->inverse(signal(C-1),&lfe_dec[0]);
+		for (unsigned m=0;m<M;m++) {
+			vec x[lfe_taps];
+			for (int i=0;i<lfe_taps;i++)
+				x[i] = lfe_dec[(m+M+i-2)%M];
+			for (unsigned j=0;j<lfe_decimation;j++) {
+				vec y = 0;
+				for (int i=0;i<lfe_taps;i++)
+					y = y + vec(lfe_interp[i*lfe_decimation+j])*x[i];
+				d[m*lfe_decimation+j] = y;
+			}
+		}
+	}
+
+	// the spectrum of channel c (N/2+1 bins, as real & imaginary packs)
+	vec *signal(unsigned c) { return &spectra[c*(N+2)]; }
+
+	// whether channel c is rendered at all
+	bool rendered(unsigned c) { return (chn_id[setup][c] & cur.channels) != 0; }
+
+	// make channel c contribute silence to this hop (its destination is zeroed once, then left as it is)
+	void clear(unsigned c) {
+		if (!dst_clear[c]) {
+			std::fill(&dst[c*N],&dst[c*N+N],vec(0));
+			dst_clear[c] = true;
+		}
+	}
+
+	// constants
+	unsigned N;						// number of samples per block
+	unsigned H;						// hop size (N/2)
+	unsigned C;						// number of output channels
+	unsigned CP;					// number of channels in the allocation table (C-1, padded as in decoder_impl)
+	channel_setup setup;			// the channel setup
+	static constexpr float sparsity_threshold = 1e-12f; // as the default of decoder_impl
+
+	// parameters (the staging block is picked up at the next hop, if fresh)
+	parameters cur, target, staging;
+	unsigned ramp;					// number of hops left until the target is reached
+	bool fresh;						// whether the staging block has changed since it was last picked up
+	bool buffer_empty;				// whether nothing has been decoded since the last flush
+
+	// tables shared with other decoders
+	std::shared_ptr<const window_tables<T> > windows;
+	std::shared_ptr<const setup_tables<T> > channel_tables;
+	const T *wnd2, *wnd;			// the analysis and synthesis windows (from windows)
+	const unsigned *side;			// side (0=L, 1=C, 2=R) whose phase each channel takes (from channel_tables)
+	const T *lfe_interp;			// LFE interpolation weights (see decoder_impl::lfe_weights())
+	std::shared_ptr<fft_lane_backend<vec> > fft, lfe_fft;
+
+	// channel allocation and LFE crossover, following the parameters
+	vector<T,simd::allocator<T> > alloc; // channel allocation table, [q][p][channel] (with the center image folded in)
+	float folded_center_image;		// the center image setting that alloc reflects
+	vector<double> lfe_xover;		// level of the LFE channel per bin (up to hi_cut)
+	float xover_lo, xover_hi;		// the cutoffs that lfe_xover was built for
+
+	// buffers, a pack per value
+	vector<vec,simd::allocator<vec> > inbuf; // stereo input ring, [frame][left/right]
+	size_t in_pos;					// position in the ring where the next frame goes
+	vector<vec,simd::allocator<vec> > zt, zf; // left total + i * right total, in time and frequency domain
+	vector<vec,simd::allocator<vec> > spectra; // the spectrum of every channel, [channel][bin][re/im]
+	vector<vec,simd::allocator<vec> > dst; // time-domain destination buffer, [channel][sample]
+	vector<bool> dst_clear;			// per channel: whether its destination holds zeros
+	vector<vec,simd::allocator<vec> > lfe_dec; // decimated LFE block
+	vector<vec,simd::allocator<vec> > tail; // second half of the previous block's output, windowed, [sample][channel]
+	vector<vec,simd::allocator<vec> > power; // power of each channel in the current block
 };
 
 
 // implementation of the shell class
-freesurround_decoder::freesurround_decoder(channel_setup setup, unsigned blocksize): impl(new decoder_impl(setup,blocksize)) { }
+freesurround_decoder::freesurround_decoder(channel_setup setup, unsigned blocksize, sample_precision precision, void *mem, size_t lenmem):
+	impl(precision == sp_float ? create_decoder<float>(setup,blocksize,mem,lenmem,false) : create_decoder<double>(setup,blocksize,mem,lenmem,false)) { }
+freesurround_decoder::freesurround_decoder(decoder_base *impl): impl(impl) { }
 freesurround_decoder::~freesurround_decoder() { delete impl; }
+freesurround_decoder *freesurround_decoder::create_generic(channel_setup setup, unsigned blocksize, sample_precision precision) {
+	return new freesurround_decoder(precision == sp_float ? create_decoder<float>(setup,blocksize,0,0,true) : create_decoder<double>(setup,blocksize,0,0,true));
+}
 float *freesurround_decoder::decode(float *input) { return impl->decode(input); }
+size_t freesurround_decoder::decode_many(const float *input, size_t frames, float *output, const unsigned *order) { return impl->decode_many(input,frames,output,order); }
+size_t freesurround_decoder::decode_planar(const float *input, size_t frames, float *const *outputs) { return impl->decode_planar(input,frames,outputs); }
 void freesurround_decoder::flush() { impl->flush(); }
 void freesurround_decoder::circular_wrap(float v) { impl->set_circular_wrap(v); }
 void freesurround_decoder::shift(float v) { impl->set_shift(v); }
@@ -276,10 +1781,51 @@ void freesurround_decoder::focus(float v) { impl->set_focus(v); }
 void freesurround_decoder::center_image(float v) { impl->set_center_image(v); }
 void freesurround_decoder::front_separation(float v) { impl->set_front_separation(v); }
 void freesurround_decoder::rear_separation(float v) { impl->set_rear_separation(v); }
+void freesurround_decoder::channel_mask(unsigned ids) { impl->set_channel_mask(ids); }
 void freesurround_decoder::low_cutoff(float v) { impl->set_low_cutoff(v); }
 void freesurround_decoder::high_cutoff(float v) { impl->set_high_cutoff(v); }
 void freesurround_decoder::bass_redirection(bool v) { impl->set_bass_redirection(v); }
+void freesurround_decoder::steering_resolution(unsigned v) { impl->set_steering_resolution(v); }
+float freesurround_decoder::steering_error(unsigned resolution) { return impl->steering_error(resolution); }
+void freesurround_decoder::reference_phases(bool v) { impl->set_reference_phases(v); }
+unsigned freesurround_decoder::steering_bands(unsigned n) { return impl->set_steering_bands(n); }
+void freesurround_decoder::steering_interval(unsigned hops, float flux) { impl->set_steering_interval(hops,flux); }
+bool freesurround_decoder::fft_implementation(const char *name) { return impl->set_fft_implementation(name); }
+bool freesurround_decoder::overlap(unsigned v) { return impl->set_overlap(v); }
+bool freesurround_decoder::low_latency(unsigned hop) { return impl->set_low_latency(hop); }
+bool freesurround_decoder::worker_threads(unsigned n, const int *cpus) { return impl->set_worker_threads(n,cpus); }
+void freesurround_decoder::silence_threshold(float v) { impl->set_silence_threshold(v); }
+void freesurround_decoder::sparsity_threshold(float v) { impl->set_sparsity_threshold(v); }
+unsigned freesurround_decoder::latency() { return impl->latency(); }
+size_t freesurround_decoder::hop_count(hop_path path) { return impl->hop_count(path); }
 unsigned freesurround_decoder::buffered() { return impl->buffered(); }
 unsigned freesurround_decoder::num_channels(channel_setup s) { return chn_id[s].size(); }
+size_t freesurround_decoder::memory_footprint(channel_setup s, unsigned blocksize, sample_precision precision) {
+	const unsigned C = chn_alloc[s].size();
+	return precision == sp_float ? decoder_impl<float>::layout(blocksize,C) : decoder_impl<double>::layout(blocksize,C);
+}
 channel_id freesurround_decoder::channel_at(channel_setup s, unsigned i) { return i < chn_id[s].size() ? chn_id[s][i] : ci_none; }
 
+// implementation of the multi-stream shell class
+freesurround_multi_decoder::freesurround_multi_decoder(channel_setup setup, unsigned blocksize, sample_precision precision):
+	impl(precision == sp_float ? (multi_decoder_base*)new multi_decoder_impl<float>(setup,blocksize) : new multi_decoder_impl<double>(setup,blocksize)) { }
+freesurround_multi_decoder::~freesurround_multi_decoder() { delete impl; }
+size_t freesurround_multi_decoder::decode_many(const float *const *inputs, size_t frames, float *const *outputs) { return impl->decode_many(inputs,frames,outputs); }
+void freesurround_multi_decoder::flush() { impl->flush(); }
+void freesurround_multi_decoder::circular_wrap(float v) { impl->set_circular_wrap(v); }
+void freesurround_multi_decoder::shift(float v) { impl->set_shift(v); }
+void freesurround_multi_decoder::depth(float v) { impl->set_depth(v); }
+void freesurround_multi_decoder::focus(float v) { impl->set_focus(v); }
+void freesurround_multi_decoder::center_image(float v) { impl->set_center_image(v); }
+void freesurround_multi_decoder::front_separation(float v) { impl->set_front_separation(v); }
+void freesurround_multi_decoder::rear_separation(float v) { impl->set_rear_separation(v); }
+void freesurround_multi_decoder::channel_mask(unsigned ids) { impl->set_channel_mask(ids); }
+void freesurround_multi_decoder::low_cutoff(float v) { impl->set_low_cutoff(v); }
+void freesurround_multi_decoder::high_cutoff(float v) { impl->set_high_cutoff(v); }
+void freesurround_multi_decoder::bass_redirection(bool v) { impl->set_bass_redirection(v); }
+bool freesurround_multi_decoder::fft_implementation(const char *name) { return impl->set_fft_implementation(name); }
+unsigned freesurround_multi_decoder::latency() { return impl->latency(); }
+unsigned freesurround_multi_decoder::streams(sample_precision precision) {
+	return precision == sp_float ? (unsigned)simd::lanes<simd::vfloat>::width : (unsigned)simd::lanes<simd::vdouble>::width;
+}
+
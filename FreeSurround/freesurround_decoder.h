@@ -18,6 +18,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
 #ifndef FREESURROUND_DECODER_H
 #define FREESURROUND_DECODER_H
+#include <cstddef>
 
 /**
 * Identifiers for the supported output channels (from front to back, left to right).
@@ -79,6 +80,30 @@ typedef enum channel_setup {
 	cs_legacy = 0 // same channels as cs_5point1 but different upmixing transform; does not support the focus control
 };
 
+/**
+* The numeric precision in which the decoder does its spectral processing.
+* Input and output are always float; sp_float halves the size of the spectral buffers and
+* doubles the SIMD width. On broadband material its output deviates from sp_double by ca. -125
+* to -135 dB, but where a source is present in one input channel only, rounding noise in the
+* other one moves its bins off the edge of the soundfield, and the SNR can drop to ca. 40 dB
+* (37 dB for panned tones in 3stereo with a circular wrap of 200, 57 dB in 16.1; see fsbench).
+*/
+enum sample_precision {
+	sp_double = 0,
+	sp_float = 1
+};
+
+/**
+* The ways in which the decoder processes a hop of input (see hop_count()).
+* A block that is silent or exactly mono (L == R) throughout skips the FFTs and the steering.
+*/
+enum hop_path {
+	hp_full = 0,	// spectral analysis, steering and synthesis
+	hp_silent = 1,	// silent block: only the tails of the previous blocks are output
+	hp_mono = 2,	// mono block: rendered with the gains of a centered source (not while bass redirection is on)
+	hp_reused = 3	// like hp_full, but with the soundfield positions of an earlier block (see steering_interval())
+};
+
 /**
 * The FreeSurround decoder.
 */
@@ -94,12 +119,18 @@ public:
 	*				   samples (default is 4096 for 44.1Khz data). Do not make it shorter or longer
 	*				   than 5ms to 20ms since the granularity at which locations are decoded
 	*				   changes with this.
+	* @param precision Precision of the internal processing (default: sp_double).
+	* @param mem Optional memory for the decoder's buffers, which are all carved out of one arena (otherwise
+	*			 the decoder allocates it); must stay valid until the decoder is destroyed.
+	* @param lenmem Size of mem in bytes. If mem is smaller than memory_footprint() for the same settings, or not
+	*				aligned to 64 bytes, it is not used.
 	*/
-	freesurround_decoder(channel_setup setup=cs_5point1, unsigned blocksize=4096);
+	freesurround_decoder(channel_setup setup=cs_5point1, unsigned blocksize=4096, sample_precision precision=sp_double,
+						 void *mem=0, size_t lenmem=0);
 	~freesurround_decoder();
 
 	/**
-	* Decode a chunk of stereo sound. The output is delayed by half of the blocksize.
+	* Decode a chunk of stereo sound. The output is delayed by latency() samples (half of the blocksize by default).
 	* This function is the only one needed for straightforward decoding.
 	* @param input Contains exactly blocksize (multiplexed) stereo samples, i.e. 2*blocksize numbers.
 	* @return A pointer to an internal buffer of exactly blocksize (multiplexed) multichannel samples.
@@ -108,6 +139,31 @@ public:
 	*/
 	float *decode(float *input);
 
+	/**
+	* Decode any number of whole hops of stereo sound in one call, writing straight into a caller-owned
+	* buffer. The output is delayed exactly as with consecutive decode() calls
+	* (which can be freely mixed with this function).
+	* @param input Contains frames (multiplexed) stereo samples, i.e. 2*frames numbers.
+	* @param frames Number of stereo samples in the input; should be a multiple of the hop size (half of the
+	*				blocksize by default, see overlap() and low_latency()); a remainder is not processed.
+	* @param output Receives frames (multiplexed) multichannel samples, i.e. frames*num_channels(setup) numbers.
+	* @param order Optional channel order of the output: order[i] is the index of the decoder channel (see channel_at())
+	*			   that is written at position i of each frame; must be a permutation of 0..num_channels(setup)-1.
+	*			   The reordering happens while the output is written and costs nothing.
+	* @return The number of frames that were processed.
+	*/
+	size_t decode_many(const float *input, size_t frames, float *output, const unsigned *order=0);
+
+	/**
+	* Like decode_many(), but with planar output: each channel is written into a buffer of its own.
+	* @param input Contains frames (multiplexed) stereo samples, i.e. 2*frames numbers.
+	* @param frames Number of stereo samples in the input; should be a multiple of the hop size.
+	* @param outputs outputs[c] receives the frames samples of decoder channel c (see channel_at());
+	*				 to reorder the channels, reorder the pointers.
+	* @return The number of frames that were processed.
+	*/
+	size_t decode_planar(const float *input, size_t frames, float *const *outputs);
+
 	/**
 	* Flush the internal buffer.
 	*/
@@ -119,6 +175,9 @@ public:
 	// The sound field is best pictured as a 2-dimensional square with the listener in its
 	// center which can be shifted or stretched in various ways before it is sent to the
 	// speakers. The order in which these transformations are applied is as listed below.
+	// The soundfield transformations, rendering parameters and bass redirection settings can be changed from any
+	// thread while another one is decoding: a change is picked up at the next hop and ramped in over one block,
+	// without a click and without the decoding thread ever waiting for a lock.
 
 	/**
 	* Allows to wrap the soundfield around the listener in a circular manner.
@@ -155,6 +214,9 @@ public:
 	/**
 	* Set the presence of the front center channel(s).
 	* Value range: [0.0..1.0] -- fully present at 1.0, fully replaced by left/right at 0.0 (default: 1).
+	* The share of the power that is taken from a center channel goes to its neighbors on either side, so the
+	* total stays the same; this is folded into the channel allocation table when the setting changes, and
+	* costs nothing per bin.
 	* The default of 1.0 results in spec-conformant decoding ("movie mode") while a value of 0.7 is
 	* better suited for music reproduction (which is usually mixed without a center channel).
 	*/
@@ -172,6 +234,13 @@ public:
 	*/
 	void rear_separation(float v);
 
+	/**
+	* Render only the given channels: a combination of channel_ids, e.g. ci_front_center for dialog extraction
+	* (default: all channels). The other channels are muted, and their synthesis is skipped altogether, so a subset
+	* costs less than the whole setup. A channel that is muted or unmuted fades out or in over one block.
+	*/
+	void channel_mask(unsigned ids);
+
 
 	// --- bass redirection (to LFE)
 
@@ -187,10 +256,124 @@ public:
 
 	/**
 	* Set the upper end of the transition band, in Hz/Nyquist (default: 90/22050).
+	* Up to 1/256 of the block size in bins (ca. 170 Hz at 44.1 kHz), the LFE channel is synthesized through
+	* a 16x smaller inverse transform; above that, through the full one.
 	*/
 	void high_cutoff(float v);
 
 
+	// --- processing options
+	// These (like flush()) must not be called while another thread is decoding.
+
+	/**
+	* Look up the soundfield position of each bin in a table of the given resolution (along the amplitude
+	* and phase difference axes), instead of evaluating the decoding polynomial and the soundfield
+	* transformations per bin. The table is rebuilt whenever a soundfield transformation or separation
+	* setting changes. Value range: 0 (off) or [2..inf] (default: 0). The maximum position error against
+	* the analytic path (a distance in the [-1..+1] x [-1..+1] soundfield, see steering_error()) is ca.
+	* 3/resolution with the default transformations (0.023 at 128, 0.011 at 256), 6.5/resolution with a
+	* circular wrap of 30 and 11/resolution with a focus of 0.9; with a strongly negative focus it shrinks
+	* more slowly (0.21 at 256 and 0.12 at 512 for -0.9). On panned tones the output then deviates from
+	* the analytic path by ca. -78 dB at 256 with the default settings, and -55 dB with a focus of -0.9
+	* (see fsbench). A resolution of 256 costs 1 MB (double) or 512 KB (float) of memory.
+	*/
+	void steering_resolution(unsigned v);
+
+	/**
+	* The largest distance between the soundfield positions looked up in a steering table of the given resolution
+	* and the analytic ones, at four points per table cell along each axis, with the soundfield transformation and
+	* separation settings as last set (see steering_resolution() and fsbench).
+	*/
+	float steering_error(unsigned resolution);
+
+	/**
+	* Steer by perceptual bands instead of by bins: the spectrum is divided into n bands that are evenly spaced
+	* on the ERB-rate scale (assuming a sampling rate of 44.1 kHz, where the spectrum spans ca. 42 ERBs), the
+	* soundfield position is computed once per band from the pooled power and cross-spectrum of the two sides,
+	* and the channel volumes of each bin are interpolated between those of the neighboring band centers. The
+	* cost of the steering then scales with the number of bands rather than with the blocksize. Useful values
+	* are 24 to 64; 0 switches back to per-bin steering (the default), so the two can be compared directly (see
+	* fsbench for the cost and the deviation). At small blocksizes the lowest bands are merged to be at least
+	* one bin wide.
+	* @return The number of bands in use.
+	*/
+	unsigned steering_bands(unsigned n);
+
+	/**
+	* Compute the soundfield positions only every hops-th hop, and reuse them for the hops in between (which then
+	* only analyze, synthesize and transform back, with the current amplitudes and phases of each bin); on
+	* stationary material this saves most of the steering cost. With a flux threshold (e.g., 0.2-0.5), a hop is
+	* steered anyway once the magnitude spectra of the two sides have changed by more than that fraction since
+	* the last steered hop, so that hops is the longest a set of positions is reused. Parameter changes and
+	* silent or mono hops always lead to fresh positions. Default: 1 (steer every hop).
+	*/
+	void steering_interval(unsigned hops, float flux=0);
+
+	/**
+	* Compute the signal phases of each bin as angles (with atan2) and the channel phasors from them
+	* (with sin/cos), as the original implementation did, instead of normalizing the spectra directly.
+	* This is slower and meant as a reference (default: false). Note that a bin that is present in
+	* only one input channel then gets an arbitrary phase difference (and position).
+	*/
+	void reference_phases(bool v);
+
+	/**
+	* Select the FFT implementation by name: "kiss" is always available, "pow2" (specialized at compile
+	* time) for block sizes of 512 to 8192, "pocketfft" and "fftw" only when they were found at build
+	* time. By default pow2 is used where it supports the block size, and kiss otherwise (see fsbench
+	* for the speed of each and its deviation from kiss on this host).
+	* @return false if no implementation of that name is available (the current one is kept).
+	*/
+	bool fft_implementation(const char *name);
+
+	/**
+	* Set the overlap of the analysis blocks, as the number of hops per block: 2 (50% overlap, the default),
+	* 4 (75%) or 8 (87.5%). A higher overlap updates the steering more often, which gives smoother
+	* transitions, at 2x/4x the cost; the output delay grows from 1/2 to 3/4 or 7/8 of the blocksize.
+	* The windows are sqrt-Hann for analysis and synthesis, scaled to overlap-add to one. This flushes
+	* the buffer.
+	* @return false if the overlap is not supported (the current one is kept).
+	*/
+	bool overlap(unsigned hops);
+
+	/**
+	* Switch to low-latency processing: the blocks advance by hop samples (e.g., 64 to 256), and an asymmetric
+	* analysis window (long rise, short fall) is paired with a synthesis window that covers only the last
+	* 2*hop samples of each block, so that the output is delayed by just one hop while the frequency
+	* resolution (the blocksize) stays the same. The cost grows with blocksize/hop, as with overlap();
+	* calling overlap() returns to the symmetric windows. This flushes the buffer.
+	* @return false if hop does not divide the blocksize or exceeds half of it (the current setting is kept).
+	*/
+	bool low_latency(unsigned hop);
+
+	/**
+	* Treat input samples whose magnitude (in both channels) is at most v as silence: a block of them is not
+	* analyzed, and produces no output of its own (default: 0, i.e. only digital silence). A negative value
+	* disables the silent and the mono path.
+	*/
+	void silence_threshold(float v);
+
+	/**
+	* Skip the inverse transform of a channel that carries at most the fraction v of the power of all channels in
+	* a block, which then contributes silence; this saves the work for channels that a block leaves (next to) empty,
+	* like the rear ones on material that is panned to the front (default: 1e-12, i.e. -120 dB; 0 skips only
+	* channels that are exactly silent, a negative value none). A disabled LFE channel is never transformed.
+	*/
+	void sparsity_threshold(float v);
+
+	/**
+	* Share the work of each hop with n worker threads (besides the thread that calls decode()), for setups and
+	* sampling rates where one core cannot keep up: the steering is split across frequency ranges, the synthesis
+	* across groups of channels, and the inverse transforms and the overlap-add across channels and output
+	* samples, joined at the end of each of these steps. The output is bit-identical to that of single-threaded
+	* decoding. The joins cost some microseconds each per hop, so this pays off only for many channels and large
+	* blocks (see fsbench). If cpus is given, worker i is pinned to the CPU cpus[i] (unless that is negative).
+	* Default: 0 (everything in the calling thread).
+	* @return false if a worker could not be pinned (it runs unpinned).
+	*/
+	bool worker_threads(unsigned n, const int *cpus=0);
+
+
 	// --- info
 
 	/**
@@ -198,6 +381,17 @@ public:
 	*/
 	unsigned buffered();
 
+	/**
+	* The algorithmic latency: the delay of the output relative to the input, in samples. When the input is
+	* passed in pieces of one hop, the caller's buffering adds one hop to that.
+	*/
+	unsigned latency();
+
+	/**
+	* Number of hops that were processed along the given path, since the decoder was created.
+	*/
+	size_t hop_count(hop_path path);
+
 	/**
 	* Number of channels in the given setup.
 	*/
@@ -208,8 +402,101 @@ public:
 	*/
 	static channel_id channel_at(channel_setup s, unsigned i);
 
+	/**
+	* Size in bytes of the arena that holds the buffers of a decoder with the given settings (see the constructor).
+	* The tables of steering_resolution() and steering_bands() are allocated separately when they are enabled. The
+	* window functions, FFT plans and channel allocation tables are shared by all decoders that use the same ones
+	* (whichever thread creates them), and are released with the last of them.
+	*/
+	static size_t memory_footprint(channel_setup setup=cs_5point1, unsigned blocksize=4096,
+								   sample_precision precision=sp_double);
+
+	/**
+	* Create a decoder like the constructor does, but with the generic implementation also for the setups that
+	* otherwise get one specialized for their number of channels (stereo, 3stereo, 4.1, 5.1 and 7.1). The output
+	* is the same; this is meant for comparing the two (see fsbench). The caller deletes the decoder.
+	*/
+	static freesurround_decoder *create_generic(channel_setup setup=cs_5point1, unsigned blocksize=4096,
+												sample_precision precision=sp_double);
+
+private:
+	explicit freesurround_decoder(class decoder_base *impl);
+	class decoder_base *impl; // private implementation
+};
+
+/**
+* A FreeSurround decoder for several independent stereo streams with the same channel setup and parameters, for bulk
+* (offline) jobs: the streams are decoded in lockstep, one in each lane of the SIMD registers, through the FFTs as well
+* as the steering, so that every instruction does the work of all of them. See fsbench for the throughput against as
+* many freesurround_decoders.
+* Each stream's output is bit-identical to that of a freesurround_decoder with the same setup, parameters and FFT
+* implementation, and a negative silence_threshold(); the other processing options keep their defaults here.
+*/
+class freesurround_multi_decoder {
+public:
+
+	/**
+	* Create an instance of the decoder.
+	* @param setup The output channel setup (see freesurround_decoder).
+	* @param blocksize Granularity at which data is processed (see freesurround_decoder).
+	* @param precision Precision of the internal processing (default: sp_float, which decodes twice as many streams at once).
+	*/
+	freesurround_multi_decoder(channel_setup setup=cs_5point1, unsigned blocksize=4096, sample_precision precision=sp_float);
+	~freesurround_multi_decoder();
+
+	/**
+	* Number of streams that are decoded at once in the given precision: the number of values in a SIMD register, i.e.
+	* 4 floats or 2 doubles with SSE2, 8 floats or 4 doubles with AVX2 (see the SIMD variable of the Makefile), and 1
+	* without SIMD support.
+	*/
+	static unsigned streams(sample_precision precision=sp_float);
+
+	/**
+	* Decode any number of whole hops of each stream. The output is delayed by latency() samples, as with
+	* freesurround_decoder::decode_many().
+	* @param inputs inputs[s] contains frames (multiplexed) stereo samples of stream s, for s < streams(); a null
+	*				pointer stands for a silent stream.
+	* @param frames Number of stereo samples in each input; should be a multiple of half the blocksize (a remainder is
+	*				not processed).
+	* @param outputs outputs[s] receives frames (multiplexed) multichannel samples of stream s; a null pointer drops
+	*				 the output of that stream.
+	* @return The number of frames that were processed.
+	*/
+	size_t decode_many(const float *const *inputs, size_t frames, float *const *outputs);
+
+	/**
+	* Flush the internal buffers.
+	*/
+	void flush();
+
+	// --- soundfield transformations, rendering parameters and bass redirection (see freesurround_decoder)
+	// These apply to all streams; they must not be called while another thread is decoding. A change is picked up
+	// at the next hop and ramped in over one block.
+	void circular_wrap(float v);
+	void shift(float v);
+	void depth(float v);
+	void focus(float v);
+	void center_image(float v);
+	void front_separation(float v);
+	void rear_separation(float v);
+	void channel_mask(unsigned ids);
+	void bass_redirection(bool v);
+	void low_cutoff(float v);
+	void high_cutoff(float v);
+
+	/**
+	* Select the FFT implementation by name: "pow2" (for block sizes of 512 to 8192; the default) or "kiss".
+	* @return false if no implementation of that name is available (the current one is kept).
+	*/
+	bool fft_implementation(const char *name);
+
+	/**
+	* The algorithmic latency: the delay of the output relative to the input, in samples (half of the blocksize).
+	*/
+	unsigned latency();
+
 private:
-	class decoder_impl *impl; // private implementation
+	class multi_decoder_base *impl; // private implementation
 };
 
 #endif
@@ -14,20 +14,22 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 
 #include "_kiss_fft_guts.h"
+#include "simd.h"
 /* The guts header contains all the multiplication and addition macros that are defined for
  fixed or floating point complex numbers.  It also delares the kf_ internal functions.
  */
 
+template<class kiss_fft_scalar>
 static void kf_bfly2(
-        kiss_fft_cpx * Fout,
+        kiss_fft_cpx<kiss_fft_scalar> * Fout,
         const size_t fstride,
-        const kiss_fft_cfg st,
+        const kiss_fft_cfg<kiss_fft_scalar> st,
         int m
         )
 {
-    kiss_fft_cpx * Fout2;
-    kiss_fft_cpx * tw1 = st->twiddles;
-    kiss_fft_cpx t;
+    kiss_fft_cpx<kiss_fft_scalar> * Fout2;
+    kiss_fft_cpx<kiss_fft_scalar> * tw1 = st->twiddles;
+    kiss_fft_cpx<kiss_fft_scalar> t;
     Fout2 = Fout + m;
     do{
         C_FIXDIV(*Fout,2); C_FIXDIV(*Fout2,2);
@@ -41,15 +43,16 @@ static void kf_bfly2(
     }while (--m);
 }
 
+template<class kiss_fft_scalar>
 static void kf_bfly4(
-        kiss_fft_cpx * Fout,
+        kiss_fft_cpx<kiss_fft_scalar> * Fout,
         const size_t fstride,
-        const kiss_fft_cfg st,
+        const kiss_fft_cfg<kiss_fft_scalar> st,
         const size_t m
         )
 {
-    kiss_fft_cpx *tw1,*tw2,*tw3;
-    kiss_fft_cpx scratch[6];
+    kiss_fft_cpx<kiss_fft_scalar> *tw1,*tw2,*tw3;
+    kiss_fft_cpx<kiss_fft_scalar> scratch[6];
     size_t k=m;
     const size_t m2=2*m;
     const size_t m3=3*m;
@@ -89,18 +92,19 @@ static void kf_bfly4(
     }while(--k);
 }
 
+template<class kiss_fft_scalar>
 static void kf_bfly3(
-         kiss_fft_cpx * Fout,
+         kiss_fft_cpx<kiss_fft_scalar> * Fout,
          const size_t fstride,
-         const kiss_fft_cfg st,
+         const kiss_fft_cfg<kiss_fft_scalar> st,
          size_t m
          )
 {
      size_t k=m;
      const size_t m2 = 2*m;
-     kiss_fft_cpx *tw1,*tw2;
-     kiss_fft_cpx scratch[5];
-     kiss_fft_cpx epi3;
+     kiss_fft_cpx<kiss_fft_scalar> *tw1,*tw2;
+     kiss_fft_cpx<kiss_fft_scalar> scratch[5];
+     kiss_fft_cpx<kiss_fft_scalar> epi3;
      epi3 = st->twiddles[fstride*m];
 
      tw1=tw2=st->twiddles;
@@ -133,19 +137,20 @@ static void kf_bfly3(
      }while(--k);
 }
 
+template<class kiss_fft_scalar>
 static void kf_bfly5(
-        kiss_fft_cpx * Fout,
+        kiss_fft_cpx<kiss_fft_scalar> * Fout,
         const size_t fstride,
-        const kiss_fft_cfg st,
+        const kiss_fft_cfg<kiss_fft_scalar> st,
         int m
         )
 {
-    kiss_fft_cpx *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
+    kiss_fft_cpx<kiss_fft_scalar> *Fout0,*Fout1,*Fout2,*Fout3,*Fout4;
     int u;
-    kiss_fft_cpx scratch[13];
-    kiss_fft_cpx * twiddles = st->twiddles;
-    kiss_fft_cpx *tw;
-    kiss_fft_cpx ya,yb;
+    kiss_fft_cpx<kiss_fft_scalar> scratch[13];
+    kiss_fft_cpx<kiss_fft_scalar> * twiddles = st->twiddles;
+    kiss_fft_cpx<kiss_fft_scalar> *tw;
+    kiss_fft_cpx<kiss_fft_scalar> ya,yb;
     ya = twiddles[fstride*m];
     yb = twiddles[fstride*2*m];
 
@@ -195,20 +200,21 @@ static void kf_bfly5(
 }
 
 /* perform the butterfly for one stage of a mixed radix FFT */
+template<class kiss_fft_scalar>
 static void kf_bfly_generic(
-        kiss_fft_cpx * Fout,
+        kiss_fft_cpx<kiss_fft_scalar> * Fout,
         const size_t fstride,
-        const kiss_fft_cfg st,
+        const kiss_fft_cfg<kiss_fft_scalar> st,
         int m,
         int p
         )
 {
     int u,k,q1,q;
-    kiss_fft_cpx * twiddles = st->twiddles;
-    kiss_fft_cpx t;
+    kiss_fft_cpx<kiss_fft_scalar> * twiddles = st->twiddles;
+    kiss_fft_cpx<kiss_fft_scalar> t;
     int Norig = st->nfft;
 
-    kiss_fft_cpx * scratch = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx)*p);
+    kiss_fft_cpx<kiss_fft_scalar> * scratch = (kiss_fft_cpx<kiss_fft_scalar>*)KISS_FFT_TMP_ALLOC(sizeof(kiss_fft_cpx<kiss_fft_scalar>)*p);
 
     for ( u=0; u<m; ++u ) {
         k=u;
@@ -234,20 +240,21 @@ static void kf_bfly_generic(
     KISS_FFT_TMP_FREE(scratch);
 }
 
+template<class kiss_fft_scalar>
 static
 void kf_work(
-        kiss_fft_cpx * Fout,
-        const kiss_fft_cpx * f,
+        kiss_fft_cpx<kiss_fft_scalar> * Fout,
+        const kiss_fft_cpx<kiss_fft_scalar> * f,
         const size_t fstride,
         int in_stride,
         int * factors,
-        const kiss_fft_cfg st
+        const kiss_fft_cfg<kiss_fft_scalar> st
         )
 {
-    kiss_fft_cpx * Fout_beg=Fout;
+    kiss_fft_cpx<kiss_fft_scalar> * Fout_beg=Fout;
     const int p=*factors++; /* the radix  */
     const int m=*factors++; /* stage's fft length/p */
-    const kiss_fft_cpx * Fout_end = Fout + p*m;
+    const kiss_fft_cpx<kiss_fft_scalar> * Fout_end = Fout + p*m;
 
 #ifdef _OPENMP
     // use openmp extensions at the 
@@ -336,17 +343,18 @@ void kf_factor(int n,int * facbuf)
  * The return value is a contiguous block of memory, allocated with malloc.  As such,
  * It can be freed with free(), rather than a kiss_fft-specific function.
  * */
-kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
+template<class kiss_fft_scalar>
+kiss_fft_cfg<kiss_fft_scalar> kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem )
 {
-    kiss_fft_cfg st=NULL;
-    size_t memneeded = sizeof(struct kiss_fft_state)
-        + sizeof(kiss_fft_cpx)*(nfft-1); /* twiddle factors*/
+    kiss_fft_cfg<kiss_fft_scalar> st=NULL;
+    size_t memneeded = sizeof(kiss_fft_state<kiss_fft_scalar>)
+        + sizeof(kiss_fft_cpx<kiss_fft_scalar>)*(nfft-1); /* twiddle factors*/
 
     if ( lenmem==NULL ) {
-        st = ( kiss_fft_cfg)new char[ memneeded ];
+        st = ( kiss_fft_cfg<kiss_fft_scalar>)new char[ memneeded ];
     }else{
         if (mem != NULL && *lenmem >= memneeded)
-            st = (kiss_fft_cfg)mem;
+            st = (kiss_fft_cfg<kiss_fft_scalar>)mem;
         *lenmem = memneeded;
     }
     if (st) {
@@ -368,21 +376,23 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem
 }
 
 
-void kiss_fft_stride(kiss_fft_cfg st,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int in_stride)
+template<class kiss_fft_scalar>
+void kiss_fft_stride(kiss_fft_cfg<kiss_fft_scalar> st,const kiss_fft_cpx<kiss_fft_scalar> *fin,kiss_fft_cpx<kiss_fft_scalar> *fout,int in_stride)
 {
     if (fin == fout) {
         //NOTE: this is not really an in-place FFT algorithm.
         //It just performs an out-of-place FFT into a temp buffer
-        kiss_fft_cpx * tmpbuf = (kiss_fft_cpx*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx)*st->nfft);
+        kiss_fft_cpx<kiss_fft_scalar> * tmpbuf = (kiss_fft_cpx<kiss_fft_scalar>*)KISS_FFT_TMP_ALLOC( sizeof(kiss_fft_cpx<kiss_fft_scalar>)*st->nfft);
         kf_work(tmpbuf,fin,1,in_stride, st->factors,st);
-        memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx)*st->nfft);
+        memcpy(fout,tmpbuf,sizeof(kiss_fft_cpx<kiss_fft_scalar>)*st->nfft);
         KISS_FFT_TMP_FREE(tmpbuf);
     }else{
         kf_work( fout, fin, 1,in_stride, st->factors,st );
     }
 }
 
-void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout)
+template<class kiss_fft_scalar>
+void kiss_fft(kiss_fft_cfg<kiss_fft_scalar> cfg,const kiss_fft_cpx<kiss_fft_scalar> *fin,kiss_fft_cpx<kiss_fft_scalar> *fout)
 {
     kiss_fft_stride(cfg,fin,fout,1);
 }
@@ -406,3 +416,18 @@ int kiss_fft_next_fast_size(int n)
     }
     return n;
 }
+
+/* instantiate the transforms for the scalar types used by the decoder */
+#define KISS_FFT_INSTANTIATE(T) \
+    template kiss_fft_cfg<T> kiss_fft_alloc<T>(int,int,void *,size_t *); \
+    template void kiss_fft_stride<T>(kiss_fft_cfg<T>,const kiss_fft_cpx<T> *,kiss_fft_cpx<T> *,int); \
+    template void kiss_fft<T>(kiss_fft_cfg<T>,const kiss_fft_cpx<T> *,kiss_fft_cpx<T> *);
+
+KISS_FFT_INSTANTIATE(double)
+KISS_FFT_INSTANTIATE(float)
+
+/* and for the SIMD packs, which run one transform per lane (see fft_lane_backend in fft_backend.h) */
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+KISS_FFT_INSTANTIATE(simd::vdouble)
+KISS_FFT_INSTANTIATE(simd::vfloat)
+#endif
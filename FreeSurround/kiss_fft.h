@@ -7,13 +7,6 @@
 #include <string.h>
 #include <malloc.h>
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-
-// we're using doubles here...
-#define kiss_fft_scalar double
-
 /*
  ATTENTION!
  If you would like a :
@@ -29,7 +22,6 @@ extern "C" {
 
 #ifdef USE_SIMD
 # include <xmmintrin.h>
-# define kiss_fft_scalar __m128
 #define KISS_FFT_MALLOC(nbytes) _mm_malloc(nbytes,16)
 #define KISS_FFT_FREE _mm_free
 #else	
@@ -40,31 +32,27 @@ extern "C" {
 
 #ifdef FIXED_POINT
 #include <sys/types.h>	
-# if (FIXED_POINT == 32)
-#  define kiss_fft_scalar int32_t
-# else	
-#  define kiss_fft_scalar int16_t
-# endif
-#else
-# ifndef kiss_fft_scalar
-/*  default is float */
-#   define kiss_fft_scalar float
-# endif
 #endif
 
-typedef struct {
+/*
+ The transforms are templates over the scalar type kiss_fft_scalar;
+ kiss_fft.cpp / kiss_fftr.cpp instantiate them for double and float.
+ */
+
+template<class kiss_fft_scalar> struct kiss_fft_cpx {
     kiss_fft_scalar r;
     kiss_fft_scalar i;
-}kiss_fft_cpx;
+};
 
-typedef struct kiss_fft_state* kiss_fft_cfg;
+template<class kiss_fft_scalar> struct kiss_fft_state;
+template<class kiss_fft_scalar> using kiss_fft_cfg = kiss_fft_state<kiss_fft_scalar>*;
 
 /* 
  *  kiss_fft_alloc
  *  
  *  Initialize a FFT (or IFFT) algorithm's cfg/state buffer.
  *
- *  typical usage:      kiss_fft_cfg mycfg=kiss_fft_alloc(1024,0,NULL,NULL);
+ *  typical usage:      kiss_fft_cfg<float> mycfg=kiss_fft_alloc<float>(1024,0,NULL,NULL);
  *
  *  The return value from fft_alloc is a cfg buffer used internally
  *  by the fft routine or NULL.
@@ -82,7 +70,8 @@ typedef struct kiss_fft_state* kiss_fft_cfg;
  *      buffer size in *lenmem.
  * */
 
-kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem); 
+template<class kiss_fft_scalar>
+kiss_fft_cfg<kiss_fft_scalar> kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem); 
 
 /*
  * kiss_fft(cfg,in_out_buf)
@@ -94,12 +83,14 @@ kiss_fft_cfg kiss_fft_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
  * Note that each element is complex and can be accessed like
     f[k].r and f[k].i
  * */
-void kiss_fft(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout);
+template<class kiss_fft_scalar>
+void kiss_fft(kiss_fft_cfg<kiss_fft_scalar> cfg,const kiss_fft_cpx<kiss_fft_scalar> *fin,kiss_fft_cpx<kiss_fft_scalar> *fout);
 
 /*
  A more generic version of the above function. It reads its input from every Nth sample.
  * */
-void kiss_fft_stride(kiss_fft_cfg cfg,const kiss_fft_cpx *fin,kiss_fft_cpx *fout,int fin_stride);
+template<class kiss_fft_scalar>
+void kiss_fft_stride(kiss_fft_cfg<kiss_fft_scalar> cfg,const kiss_fft_cpx<kiss_fft_scalar> *fin,kiss_fft_cpx<kiss_fft_scalar> *fout,int fin_stride);
 
 /* If kiss_fft_alloc allocated a buffer, it is one contiguous 
    buffer and can be simply free()d when no longer needed*/
@@ -121,8 +112,4 @@ int kiss_fft_next_fast_size(int n);
 #define kiss_fftr_next_fast_size_real(n) \
         (kiss_fft_next_fast_size( ((n)+1)>>1)<<1)
 
-#ifdef __cplusplus
-} 
-#endif
-
 #endif
@@ -14,20 +14,24 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include "kiss_fftr.h"
 #include "_kiss_fft_guts.h"
-
-struct kiss_fftr_state{
-    kiss_fft_cfg substate;
-    kiss_fft_cpx * tmpbuf;
-    kiss_fft_cpx * super_twiddles;
+#include "simd.h"
+
+/* (aligned such that the substate and buffers behind it are aligned for kiss_fft_scalar as well) */
+template<class kiss_fft_scalar>
+struct alignas(alignof(kiss_fft_scalar) > alignof(void*) ? alignof(kiss_fft_scalar) : alignof(void*)) kiss_fftr_state{
+    kiss_fft_cfg<kiss_fft_scalar> substate;
+    kiss_fft_cpx<kiss_fft_scalar> * tmpbuf;
+    kiss_fft_cpx<kiss_fft_scalar> * super_twiddles;
 #ifdef USE_SIMD    
     void * pad;
 #endif    
 };
 
-kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
+template<class kiss_fft_scalar>
+kiss_fftr_cfg<kiss_fft_scalar> kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenmem)
 {
     int i;
-    kiss_fftr_cfg st = NULL;
+    kiss_fftr_cfg<kiss_fft_scalar> st = NULL;
     size_t subsize = 65536*4, memneeded = 0;
 
     if (nfft & 1) {
@@ -36,23 +40,23 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     }
     nfft >>= 1;
 
-    kiss_fft_alloc (nfft, inverse_fft, NULL, &subsize);
-    memneeded = sizeof(struct kiss_fftr_state) + subsize + sizeof(kiss_fft_cpx) * ( nfft * 3 / 2);
+    kiss_fft_alloc<kiss_fft_scalar> (nfft, inverse_fft, NULL, &subsize);
+    memneeded = sizeof(kiss_fftr_state<kiss_fft_scalar>) + subsize + sizeof(kiss_fft_cpx<kiss_fft_scalar>) * ( nfft * 3 / 2);
 
     if (lenmem == NULL) {
-        st = (kiss_fftr_cfg) new char[memneeded];
+        st = (kiss_fftr_cfg<kiss_fft_scalar>) new char[memneeded];
     } else {
         if (*lenmem >= memneeded)
-            st = (kiss_fftr_cfg) mem;
+            st = (kiss_fftr_cfg<kiss_fft_scalar>) mem;
         *lenmem = memneeded;
     }
     if (!st)
         return NULL;
 
-    st->substate = (kiss_fft_cfg) (st + 1); /*just beyond kiss_fftr_state struct */
-    st->tmpbuf = (kiss_fft_cpx *) (((char *) st->substate) + subsize);
+    st->substate = (kiss_fft_cfg<kiss_fft_scalar>) (st + 1); /*just beyond kiss_fftr_state struct */
+    st->tmpbuf = (kiss_fft_cpx<kiss_fft_scalar> *) (((char *) st->substate) + subsize);
     st->super_twiddles = st->tmpbuf + nfft;
-    kiss_fft_alloc(nfft, inverse_fft, st->substate, &subsize);
+    kiss_fft_alloc<kiss_fft_scalar>(nfft, inverse_fft, st->substate, &subsize);
 
     for (i = 0; i < nfft/2; ++i) {
         double phase =
@@ -64,11 +68,12 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem,size_t * lenme
     return st;
 }
 
-void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata)
+template<class kiss_fft_scalar>
+void kiss_fftr(kiss_fftr_cfg<kiss_fft_scalar> st,const kiss_fft_scalar *timedata,kiss_fft_cpx<kiss_fft_scalar> *freqdata)
 {
     /* input buffer timedata is stored row-wise */
     int k,ncfft;
-    kiss_fft_cpx fpnk,fpk,f1k,f2k,tw,tdc;
+    kiss_fft_cpx<kiss_fft_scalar> fpnk,fpk,f1k,f2k,tw,tdc;
 
     if ( st->substate->inverse) {
         fprintf(stderr,"kiss fft usage error: improper alloc\n");
@@ -78,7 +83,7 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     ncfft = st->substate->nfft;
 
     /*perform the parallel fft of two real signals packed in real,imag*/
-    kiss_fft( st->substate , (const kiss_fft_cpx*)timedata, st->tmpbuf );
+    kiss_fft( st->substate , (const kiss_fft_cpx<kiss_fft_scalar>*)timedata, st->tmpbuf );
     /* The real part of the DC element of the frequency spectrum in st->tmpbuf
      * contains the sum of the even-numbered elements of the input time sequence
      * The imag part is the sum of the odd-numbered elements
@@ -120,7 +125,14 @@ void kiss_fftr(kiss_fftr_cfg st,const kiss_fft_scalar *timedata,kiss_fft_cpx *fr
     }
 }
 
-void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata)
+template<class kiss_fft_scalar>
+void kiss_fftri(kiss_fftr_cfg<kiss_fft_scalar> st,const kiss_fft_cpx<kiss_fft_scalar> *freqdata,kiss_fft_scalar *timedata)
+{
+    kiss_fftri(st,freqdata,timedata,st->tmpbuf);
+}
+
+template<class kiss_fft_scalar>
+void kiss_fftri(kiss_fftr_cfg<kiss_fft_scalar> st,const kiss_fft_cpx<kiss_fft_scalar> *freqdata,kiss_fft_scalar *timedata,kiss_fft_cpx<kiss_fft_scalar> *tmpbuf)
 {
     /* input buffer timedata is stored row-wise */
     int k, ncfft;
@@ -132,12 +144,12 @@ void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *t
 
     ncfft = st->substate->nfft;
 
-    st->tmpbuf[0].r = freqdata[0].r + freqdata[ncfft].r;
-    st->tmpbuf[0].i = freqdata[0].r - freqdata[ncfft].r;
-    C_FIXDIV(st->tmpbuf[0],2);
+    tmpbuf[0].r = freqdata[0].r + freqdata[ncfft].r;
+    tmpbuf[0].i = freqdata[0].r - freqdata[ncfft].r;
+    C_FIXDIV(tmpbuf[0],2);
 
     for (k = 1; k <= ncfft / 2; ++k) {
-        kiss_fft_cpx fk, fnkc, fek, fok, tmp;
+        kiss_fft_cpx<kiss_fft_scalar> fk, fnkc, fek, fok, tmp;
         fk = freqdata[k];
         fnkc.r = freqdata[ncfft - k].r;
         fnkc.i = -freqdata[ncfft - k].i;
@@ -147,13 +159,29 @@ void kiss_fftri(kiss_fftr_cfg st,const kiss_fft_cpx *freqdata,kiss_fft_scalar *t
         C_ADD (fek, fk, fnkc);
         C_SUB (tmp, fk, fnkc);
         C_MUL (fok, tmp, st->super_twiddles[k-1]);
-        C_ADD (st->tmpbuf[k],     fek, fok);
-        C_SUB (st->tmpbuf[ncfft - k], fek, fok);
+        C_ADD (tmpbuf[k],     fek, fok);
+        C_SUB (tmpbuf[ncfft - k], fek, fok);
 #ifdef USE_SIMD        
-        st->tmpbuf[ncfft - k].i *= _mm_set1_ps(-1.0);
+        tmpbuf[ncfft - k].i *= _mm_set1_ps(-1.0);
 #else
-        st->tmpbuf[ncfft - k].i *= -1;
+        tmpbuf[ncfft - k].i *= -1;
 #endif
     }
-    kiss_fft (st->substate, st->tmpbuf, (kiss_fft_cpx *) timedata);
+    kiss_fft (st->substate, tmpbuf, (kiss_fft_cpx<kiss_fft_scalar> *) timedata);
 }
+
+/* instantiate the transforms for the scalar types used by the decoder */
+#define KISS_FFTR_INSTANTIATE(T) \
+    template kiss_fftr_cfg<T> kiss_fftr_alloc<T>(int,int,void *,size_t *); \
+    template void kiss_fftr<T>(kiss_fftr_cfg<T>,const T *,kiss_fft_cpx<T> *); \
+    template void kiss_fftri<T>(kiss_fftr_cfg<T>,const kiss_fft_cpx<T> *,T *); \
+    template void kiss_fftri<T>(kiss_fftr_cfg<T>,const kiss_fft_cpx<T> *,T *,kiss_fft_cpx<T> *);
+
+KISS_FFTR_INSTANTIATE(double)
+KISS_FFTR_INSTANTIATE(float)
+
+/* and for the SIMD packs, which run one transform per lane (see fft_lane_backend in fft_backend.h) */
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+KISS_FFTR_INSTANTIATE(simd::vdouble)
+KISS_FFTR_INSTANTIATE(simd::vfloat)
+#endif
@@ -2,9 +2,6 @@
 #define KISS_FTR_H
 
 #include "kiss_fft.h"
-#ifdef __cplusplus
-extern "C" {
-#endif
 
     
 /* 
@@ -15,10 +12,12 @@ extern "C" {
  
  */
 
-typedef struct kiss_fftr_state *kiss_fftr_cfg;
+template<class kiss_fft_scalar> struct kiss_fftr_state;
+template<class kiss_fft_scalar> using kiss_fftr_cfg = kiss_fftr_state<kiss_fft_scalar>*;
 
 
-kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem, size_t * lenmem);
+template<class kiss_fft_scalar>
+kiss_fftr_cfg<kiss_fft_scalar> kiss_fftr_alloc(int nfft,int inverse_fft,void * mem, size_t * lenmem);
 /*
  nfft must be even
 
@@ -26,21 +25,27 @@ kiss_fftr_cfg kiss_fftr_alloc(int nfft,int inverse_fft,void * mem, size_t * lenm
 */
 
 
-void kiss_fftr(kiss_fftr_cfg cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx *freqdata);
+template<class kiss_fft_scalar>
+void kiss_fftr(kiss_fftr_cfg<kiss_fft_scalar> cfg,const kiss_fft_scalar *timedata,kiss_fft_cpx<kiss_fft_scalar> *freqdata);
 /*
  input timedata has nfft scalar points
  output freqdata has nfft/2+1 complex points
 */
 
-void kiss_fftri(kiss_fftr_cfg cfg,const kiss_fft_cpx *freqdata,kiss_fft_scalar *timedata);
+template<class kiss_fft_scalar>
+void kiss_fftri(kiss_fftr_cfg<kiss_fft_scalar> cfg,const kiss_fft_cpx<kiss_fft_scalar> *freqdata,kiss_fft_scalar *timedata);
 /*
  input freqdata has  nfft/2+1 complex points
  output timedata has nfft scalar points
 */
 
+template<class kiss_fft_scalar>
+void kiss_fftri(kiss_fftr_cfg<kiss_fft_scalar> cfg,const kiss_fft_cpx<kiss_fft_scalar> *freqdata,kiss_fft_scalar *timedata,kiss_fft_cpx<kiss_fft_scalar> *tmpbuf);
+/*
+ like kiss_fftri, with nfft/2 complex points of scratch space in tmpbuf instead of the one in cfg,
+ so that several threads can use the same cfg at once
+*/
+
 #define kiss_fftr_free free
 
-#ifdef __cplusplus
-}
-#endif
 #endif
@@ -0,0 +1,313 @@
+/*
+Copyright (C) 2021 Brian Barnes
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+#include <cmath>
+#include <cstddef>
+#include <new>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#endif
+
+// Thin wrappers around the SIMD registers used by the decoder's spectral kernels.
+// The kernels are written once as templates over the value type V and instantiated
+// either for a plain scalar (one bin at a time) or for a pack (several bins in lockstep).
+// Comparisons on a pack yield a bit mask of the same type, which select() consumes,
+// so that the same source text works for both.
+namespace simd {
+
+#if defined(SIMD_AVX2)
+
+// four doubles (AVX2)
+struct vdouble {
+	enum { width = 4 };
+	__m256d v;
+	vdouble() { }
+	vdouble(__m256d v): v(v) { }
+	vdouble(double x): v(_mm256_set1_pd(x)) { }
+};
+inline void load(vdouble &a, const double *p) { a = _mm256_loadu_pd(p); }
+inline void store(double *p, vdouble a) { _mm256_storeu_pd(p,a.v); }
+inline vdouble operator+(vdouble a, vdouble b) { return _mm256_add_pd(a.v,b.v); }
+inline vdouble operator-(vdouble a, vdouble b) { return _mm256_sub_pd(a.v,b.v); }
+inline vdouble operator*(vdouble a, vdouble b) { return _mm256_mul_pd(a.v,b.v); }
+inline vdouble operator/(vdouble a, vdouble b) { return _mm256_div_pd(a.v,b.v); }
+inline vdouble operator-(vdouble a) { return _mm256_xor_pd(a.v,_mm256_set1_pd(-0.0)); }
+inline vdouble operator<(vdouble a, vdouble b) { return _mm256_cmp_pd(a.v,b.v,_CMP_LT_OQ); }
+inline vdouble operator>(vdouble a, vdouble b) { return _mm256_cmp_pd(a.v,b.v,_CMP_GT_OQ); }
+inline vdouble operator<=(vdouble a, vdouble b) { return _mm256_cmp_pd(a.v,b.v,_CMP_LE_OQ); }
+inline vdouble operator>=(vdouble a, vdouble b) { return _mm256_cmp_pd(a.v,b.v,_CMP_GE_OQ); }
+inline vdouble operator==(vdouble a, vdouble b) { return _mm256_cmp_pd(a.v,b.v,_CMP_EQ_OQ); }
+inline vdouble operator&(vdouble a, vdouble b) { return _mm256_and_pd(a.v,b.v); }
+inline vdouble operator|(vdouble a, vdouble b) { return _mm256_or_pd(a.v,b.v); }
+inline vdouble select(vdouble m, vdouble a, vdouble b) { return _mm256_blendv_pd(b.v,a.v,m.v); }
+inline vdouble abs(vdouble a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0),a.v); }
+inline vdouble min(vdouble a, vdouble b) { return _mm256_min_pd(a.v,b.v); }
+inline vdouble max(vdouble a, vdouble b) { return _mm256_max_pd(a.v,b.v); }
+inline vdouble sqrt(vdouble a) { return _mm256_sqrt_pd(a.v); }
+inline vdouble floor(vdouble a) { return _mm256_floor_pd(a.v); }
+// mask of the lanes whose sign bit is set (this includes -0.0)
+inline vdouble negative(vdouble a) { return _mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_setzero_si256(),_mm256_castpd_si256(a.v))); }
+// write the packs re/im as interleaved complex numbers
+inline void store_complex(double *p, vdouble re, vdouble im) {
+	__m256d lo = _mm256_unpacklo_pd(re.v,im.v), hi = _mm256_unpackhi_pd(re.v,im.v);
+	_mm256_storeu_pd(p,_mm256_permute2f128_pd(lo,hi,0x20));
+	_mm256_storeu_pd(p+4,_mm256_permute2f128_pd(lo,hi,0x31));
+}
+// round each lane to single precision
+inline vdouble round_float(vdouble a) { return _mm256_cvtps_pd(_mm256_cvtpd_ps(a.v)); }
+
+// eight floats (AVX2)
+struct vfloat {
+	enum { width = 8 };
+	__m256 v;
+	vfloat() { }
+	vfloat(__m256 v): v(v) { }
+	vfloat(float x): v(_mm256_set1_ps(x)) { }
+};
+inline void load(vfloat &a, const float *p) { a = _mm256_loadu_ps(p); }
+inline void store(float *p, vfloat a) { _mm256_storeu_ps(p,a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { return _mm256_add_ps(a.v,b.v); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm256_sub_ps(a.v,b.v); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm256_mul_ps(a.v,b.v); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm256_div_ps(a.v,b.v); }
+inline vfloat operator-(vfloat a) { return _mm256_xor_ps(a.v,_mm256_set1_ps(-0.0f)); }
+inline vfloat operator<(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v,b.v,_CMP_LT_OQ); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v,b.v,_CMP_GT_OQ); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v,b.v,_CMP_LE_OQ); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v,b.v,_CMP_GE_OQ); }
+inline vfloat operator==(vfloat a, vfloat b) { return _mm256_cmp_ps(a.v,b.v,_CMP_EQ_OQ); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm256_and_ps(a.v,b.v); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm256_or_ps(a.v,b.v); }
+inline vfloat select(vfloat m, vfloat a, vfloat b) { return _mm256_blendv_ps(b.v,a.v,m.v); }
+inline vfloat abs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f),a.v); }
+inline vfloat min(vfloat a, vfloat b) { return _mm256_min_ps(a.v,b.v); }
+inline vfloat max(vfloat a, vfloat b) { return _mm256_max_ps(a.v,b.v); }
+inline vfloat sqrt(vfloat a) { return _mm256_sqrt_ps(a.v); }
+inline vfloat floor(vfloat a) { return _mm256_floor_ps(a.v); }
+inline vfloat negative(vfloat a) { return _mm256_castsi256_ps(_mm256_srai_epi32(_mm256_castps_si256(a.v),31)); }
+inline void store_complex(float *p, vfloat re, vfloat im) {
+	__m256 lo = _mm256_unpacklo_ps(re.v,im.v), hi = _mm256_unpackhi_ps(re.v,im.v);
+	_mm256_storeu_ps(p,_mm256_permute2f128_ps(lo,hi,0x20));
+	_mm256_storeu_ps(p+8,_mm256_permute2f128_ps(lo,hi,0x31));
+}
+inline vfloat round_float(vfloat a) { return a; }
+
+#elif defined(SIMD_SSE2)
+
+// two doubles (SSE2)
+struct vdouble {
+	enum { width = 2 };
+	__m128d v;
+	vdouble() { }
+	vdouble(__m128d v): v(v) { }
+	vdouble(double x): v(_mm_set1_pd(x)) { }
+};
+inline void load(vdouble &a, const double *p) { a = _mm_loadu_pd(p); }
+inline void store(double *p, vdouble a) { _mm_storeu_pd(p,a.v); }
+inline vdouble operator+(vdouble a, vdouble b) { return _mm_add_pd(a.v,b.v); }
+inline vdouble operator-(vdouble a, vdouble b) { return _mm_sub_pd(a.v,b.v); }
+inline vdouble operator*(vdouble a, vdouble b) { return _mm_mul_pd(a.v,b.v); }
+inline vdouble operator/(vdouble a, vdouble b) { return _mm_div_pd(a.v,b.v); }
+inline vdouble operator-(vdouble a) { return _mm_xor_pd(a.v,_mm_set1_pd(-0.0)); }
+inline vdouble operator<(vdouble a, vdouble b) { return _mm_cmplt_pd(a.v,b.v); }
+inline vdouble operator>(vdouble a, vdouble b) { return _mm_cmpgt_pd(a.v,b.v); }
+inline vdouble operator<=(vdouble a, vdouble b) { return _mm_cmple_pd(a.v,b.v); }
+inline vdouble operator>=(vdouble a, vdouble b) { return _mm_cmpge_pd(a.v,b.v); }
+inline vdouble operator==(vdouble a, vdouble b) { return _mm_cmpeq_pd(a.v,b.v); }
+inline vdouble operator&(vdouble a, vdouble b) { return _mm_and_pd(a.v,b.v); }
+inline vdouble operator|(vdouble a, vdouble b) { return _mm_or_pd(a.v,b.v); }
+inline vdouble select(vdouble m, vdouble a, vdouble b) { return _mm_or_pd(_mm_and_pd(m.v,a.v),_mm_andnot_pd(m.v,b.v)); }
+inline vdouble abs(vdouble a) { return _mm_andnot_pd(_mm_set1_pd(-0.0),a.v); }
+inline vdouble min(vdouble a, vdouble b) { return _mm_min_pd(a.v,b.v); }
+inline vdouble max(vdouble a, vdouble b) { return _mm_max_pd(a.v,b.v); }
+inline vdouble sqrt(vdouble a) { return _mm_sqrt_pd(a.v); }
+inline vdouble floor(vdouble a) {
+	// SSE2 has no rounding instruction; truncate and correct the negative lanes
+	vdouble t = _mm_cvtepi32_pd(_mm_cvttpd_epi32(a.v));
+	return t - (_mm_and_pd((t > a).v,_mm_set1_pd(1.0)));
+}
+inline vdouble negative(vdouble a) { return _mm_castsi128_pd(_mm_srai_epi32(_mm_shuffle_epi32(_mm_castpd_si128(a.v),_MM_SHUFFLE(3,3,1,1)),31)); }
+inline void store_complex(double *p, vdouble re, vdouble im) {
+	_mm_storeu_pd(p,_mm_unpacklo_pd(re.v,im.v));
+	_mm_storeu_pd(p+2,_mm_unpackhi_pd(re.v,im.v));
+}
+// round each lane to single precision
+inline vdouble round_float(vdouble a) { return _mm_cvtps_pd(_mm_cvtpd_ps(a.v)); }
+
+// four floats (SSE2)
+struct vfloat {
+	enum { width = 4 };
+	__m128 v;
+	vfloat() { }
+	vfloat(__m128 v): v(v) { }
+	vfloat(float x): v(_mm_set1_ps(x)) { }
+};
+inline void load(vfloat &a, const float *p) { a = _mm_loadu_ps(p); }
+inline void store(float *p, vfloat a) { _mm_storeu_ps(p,a.v); }
+inline vfloat operator+(vfloat a, vfloat b) { return _mm_add_ps(a.v,b.v); }
+inline vfloat operator-(vfloat a, vfloat b) { return _mm_sub_ps(a.v,b.v); }
+inline vfloat operator*(vfloat a, vfloat b) { return _mm_mul_ps(a.v,b.v); }
+inline vfloat operator/(vfloat a, vfloat b) { return _mm_div_ps(a.v,b.v); }
+inline vfloat operator-(vfloat a) { return _mm_xor_ps(a.v,_mm_set1_ps(-0.0f)); }
+inline vfloat operator<(vfloat a, vfloat b) { return _mm_cmplt_ps(a.v,b.v); }
+inline vfloat operator>(vfloat a, vfloat b) { return _mm_cmpgt_ps(a.v,b.v); }
+inline vfloat operator<=(vfloat a, vfloat b) { return _mm_cmple_ps(a.v,b.v); }
+inline vfloat operator>=(vfloat a, vfloat b) { return _mm_cmpge_ps(a.v,b.v); }
+inline vfloat operator==(vfloat a, vfloat b) { return _mm_cmpeq_ps(a.v,b.v); }
+inline vfloat operator&(vfloat a, vfloat b) { return _mm_and_ps(a.v,b.v); }
+inline vfloat operator|(vfloat a, vfloat b) { return _mm_or_ps(a.v,b.v); }
+inline vfloat select(vfloat m, vfloat a, vfloat b) { return _mm_or_ps(_mm_and_ps(m.v,a.v),_mm_andnot_ps(m.v,b.v)); }
+inline vfloat abs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f),a.v); }
+inline vfloat min(vfloat a, vfloat b) { return _mm_min_ps(a.v,b.v); }
+inline vfloat max(vfloat a, vfloat b) { return _mm_max_ps(a.v,b.v); }
+inline vfloat sqrt(vfloat a) { return _mm_sqrt_ps(a.v); }
+inline vfloat floor(vfloat a) {
+	vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+	return t - (_mm_and_ps((t > a).v,_mm_set1_ps(1.0f)));
+}
+inline vfloat negative(vfloat a) { return _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(a.v),31)); }
+inline void store_complex(float *p, vfloat re, vfloat im) {
+	_mm_storeu_ps(p,_mm_unpacklo_ps(re.v,im.v));
+	_mm_storeu_ps(p+4,_mm_unpackhi_ps(re.v,im.v));
+}
+inline vfloat round_float(vfloat a) { return a; }
+
+#else
+
+// no SIMD support on this target: packs degenerate to plain scalars
+typedef double vdouble;
+typedef float vfloat;
+
+#endif
+
+// the pack type used for a given scalar type
+template<class T> struct pack { };
+template<> struct pack<double> { typedef vdouble type; };
+template<> struct pack<float> { typedef vfloat type; };
+
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+// compound assignments (for code that is written against plain scalars, like kiss_fft)
+inline vdouble &operator+=(vdouble &a, vdouble b) { return a = a + b; }
+inline vdouble &operator-=(vdouble &a, vdouble b) { return a = a - b; }
+inline vdouble &operator*=(vdouble &a, vdouble b) { return a = a * b; }
+inline vfloat &operator+=(vfloat &a, vfloat b) { return a = a + b; }
+inline vfloat &operator-=(vfloat &a, vfloat b) { return a = a - b; }
+inline vfloat &operator*=(vfloat &a, vfloat b) { return a = a * b; }
+#endif
+
+// scalar counterparts, so that the kernels can also be instantiated one value at a time
+template<class T> inline void load(T &a, const T *p) { a = *p; }
+template<class T> inline void store(T *p, T a) { *p = a; }
+template<class T, class U> inline T select(bool m, U a, T b) { return m ? T(a) : b; }
+template<class T> inline T abs(T a) { return std::abs(a); }
+template<class T> inline T min(T a, T b) { return a<b?a:b; }
+template<class T> inline T max(T a, T b) { return a>b?a:b; }
+template<class T> inline T sqrt(T a) { return std::sqrt(a); }
+template<class T> inline T floor(T a) { return std::floor(a); }
+template<class T> inline bool negative(T a) { return std::signbit(a); }
+template<class T> inline void store_complex(T *p, T re, T im) { p[0] = re; p[1] = im; }
+template<class T> inline T round_float(T a) { return (float)a; }
+
+// union of two masks (bitwise on packs, logical on scalars)
+template<class V> inline V mask_or(V a, V b) { return a | b; }
+inline double mask_or(double a, double b) { return a != 0 || b != 0; }
+inline float mask_or(float a, float b) { return a != 0 || b != 0; }
+
+// allocator for tables that are read a pack at a time (aligned to a cache line)
+template<class T> struct allocator {
+	typedef T value_type;
+	allocator() { }
+	template<class U> allocator(const allocator<U> &) { }
+	T *allocate(std::size_t n) { return (T*)::operator new(n*sizeof(T),std::align_val_t(64)); }
+	void deallocate(T *p, std::size_t) { ::operator delete(p,std::align_val_t(64)); }
+	template<class U> bool operator==(const allocator<U> &) const { return true; }
+	template<class U> bool operator!=(const allocator<U> &) const { return false; }
+};
+
+// flushes denormal results (and inputs) to zero while in scope; the steering polynomials underflow for small
+// amplitude and phase differences in single precision, and denormals are very slow on x86
+struct flush_denormals {
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2)
+	flush_denormals(): mxcsr(_mm_getcsr()) { _mm_setcsr(mxcsr | 0x8040); }	// FTZ | DAZ
+	~flush_denormals() { _mm_setcsr(mxcsr); }
+	unsigned mxcsr;
+#endif
+};
+
+// number of values processed in lockstep by V
+template<class V> struct lanes { enum { width = V::width }; };
+template<> struct lanes<double> { enum { width = 1 }; };
+template<> struct lanes<float> { enum { width = 1 }; };
+
+// arctangent of x in [0,1] (Cephes polynomial, ~1 ulp)
+template<class V> inline V atan01(V x) {
+	V big = x > 0.66;
+	x = select(big,(x-1)/(x+1),x);
+	V z = x*x;
+	V p = (((-8.750608600031904122785E-1*z - 1.615753718733365076637E1)*z - 7.500855792314704667340E1)*z
+		- 1.228866684490136173410E2)*z - 6.485021904942025371773E1;
+	V q = ((((z + 2.485846490142306297962E1)*z + 1.650270098316988542046E2)*z + 4.328810604912902668951E2)*z
+		+ 4.853903996359136964868E2)*z + 1.945506571482613964425E2;
+	z = x*(z*p/q) + x;
+	return select(big,z + (0.78539816339744830962 + 0.5*6.123233995736765886130E-17),z);
+}
+
+// four-quadrant arctangent, matching std::atan2 including the signed-zero cases
+template<class V> inline V atan2(V y, V x) {
+	const double pi = 3.14159265358979323846;
+	V ax = abs(x), ay = abs(y);
+	V hi = max(ax,ay), lo = min(ax,ay);
+	V r = atan01(select(hi == 0,V(0),lo/hi));
+	r = select(ay > ax,pi/2 - r,r);
+	r = select(negative(x),pi - r,r);
+	return select(negative(y),-r,r);
+}
+
+// sine and cosine of x (Cephes polynomials with 3-part pi/4 reduction, ~1 ulp for moderate |x|)
+template<class V> inline void sincos(V x, V &s, V &c) {
+	V neg = negative(x);
+	x = abs(x);
+	// octant index, rounded up to an even number
+	V j = floor(x * 1.27323954473516268615);
+	j = j + (j - 2*floor(j*0.5));
+	V z = ((x - j*7.85398125648498535156E-1) - j*3.77489470793079817668E-8) - j*2.69515142907905952645E-15;
+	V zz = z*z;
+	V ps = z + z*zz*(((((1.58962301576546568060E-10*zz - 2.50507477628578072866E-8)*zz + 2.75573136213857245213E-6)*zz
+		- 1.98412698295895385996E-4)*zz + 8.33333333332211858878E-3)*zz - 1.66666666666666307295E-1);
+	V pc = 1 - 0.5*zz + zz*zz*(((((-1.13585365213876817300E-11*zz + 2.08757008419747316778E-9)*zz - 2.75573141792967388112E-7)*zz
+		+ 2.48015872888517045348E-5)*zz - 1.38888888888730564116E-3)*zz + 4.16666666666665929218E-2);
+	// fold the octant back in
+	V k = j - 8*floor(j*0.125);
+	V swap = (k == 2) | (k == 6);
+	s = select(swap,pc,ps);
+	c = select(swap,ps,pc);
+	s = select(k >= 4,-s,s);
+	s = select(neg,-s,s);
+	c = select(mask_or(k == 2,k == 4),-c,c);
+}
+
+}
+
+#endif
@@ -0,0 +1,747 @@
+/*
+    fsbench - FreeSurround performance benchmarks
+
+    Copyright (c) 2021 Brian Barnes
+
+    This program is free software; you can redistribute it and/or
+    modify it under the terms of the GNU General Public License
+    as published by the Free Software Foundation; either version 3
+    of the License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "FreeSurround/freesurround_decoder.h"
+#include "FreeSurround/fft_backend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <complex>
+#include <thread>
+#include <atomic>
+#include <malloc.h>
+
+// run fn repeatedly for about the given time and return the best time per call, in microseconds
+template<class F> double time_us(F fn, double budget_ms = 200) {
+    typedef std::chrono::steady_clock clock;
+    double best = 1e30;
+    clock::time_point start = clock::now();
+    for (unsigned reps = 1;; reps *= 2) {
+        clock::time_point t0 = clock::now();
+        for (unsigned r = 0; r < reps; r++)
+            fn();
+        clock::time_point t1 = clock::now();
+        best = std::min(best, std::chrono::duration<double,std::micro>(t1 - t0).count() / reps);
+        if (std::chrono::duration<double,std::milli>(t1 - start).count() > budget_ms)
+            return best;
+    }
+}
+
+// time one hop's worth of transforms (one complex forward, one real inverse) for each backend and block size
+// ('-' where a backend does not support the size), and check both results against kiss: the largest error relative
+// to the largest value, in dB (fails above -100 dB in double and -60 dB in float)
+template<class T> bool bench_fft(const char *precision) {
+    std::vector<std::string> backends = fft_backends();
+    std::vector<double> errors;
+    const double limit = sizeof(T) == sizeof(double) ? -100 : -60;
+    printf("FFT backends, %s: microseconds per hop (complex forward + real inverse)\n", precision);
+    printf("%8s", "N");
+    for (unsigned b = 0; b < backends.size(); b++)
+        printf("%12s", backends[b].c_str());
+    printf("\n");
+    for (unsigned N = 256; N <= 16384; N *= 2) {
+        std::vector<std::complex<T> > in(N), out(N), ref_out(N);
+        std::vector<T> dst(N), ref_dst(N);
+        for (unsigned k = 0; k < N; k++)
+            in[k] = std::complex<T>(sin(0.1*k), cos(0.37*k));
+        fft_backend<T> *kiss = create_fft_backend<T>(N, "kiss");
+        kiss->forward(&in[0], &ref_out[0]);
+        kiss->inverse(&ref_out[0], &ref_dst[0]);
+        delete kiss;
+        printf("%8u", N);
+        for (unsigned b = 0; b < backends.size(); b++) {
+            fft_backend<T> *fft = create_fft_backend<T>(N, backends[b]);
+            if (!fft) {
+                printf("%12s", "-");
+                errors.push_back(-999);
+                continue;
+            }
+            printf("%12.2f", time_us([&]() { fft->forward(&in[0], &out[0]); fft->inverse(&out[0], &dst[0]); }));
+            fft->forward(&in[0], &out[0]);
+            fft->inverse(&ref_out[0], &dst[0]);
+            double err = 0, peak = 0, err_dst = 0, peak_dst = 0;
+            for (unsigned k = 0; k < N; k++) {
+                err = std::max(err, (double)std::abs(out[k] - ref_out[k]));
+                peak = std::max(peak, (double)std::abs(ref_out[k]));
+                err_dst = std::max(err_dst, (double)std::abs(dst[k] - ref_dst[k]));
+                peak_dst = std::max(peak_dst, (double)std::abs(ref_dst[k]));
+            }
+            err = std::max(err/peak, err_dst/peak_dst);
+            errors.push_back(err ? 20*log10(err) : -999);
+            delete fft;
+        }
+        printf("\n");
+    }
+    printf("%8s", "vs kiss");
+    bool ok = true;
+    for (unsigned b = 0; b < backends.size(); b++) {
+        double worst = -999;
+        for (unsigned i = b; i < errors.size(); i += backends.size())
+            worst = std::max(worst, errors[i]);
+        ok = ok && worst <= limit;
+        if (worst > -999)
+            printf("%12.1f", worst);
+        else
+            printf("%12s", "identical");
+    }
+    printf("\n\n");
+    return ok;
+}
+
+// a few seconds of decorrelated noise with a panned tone, as test input
+std::vector<float> test_signal(unsigned frames) {
+    std::vector<float> signal(2*frames);
+    unsigned seed = 1;
+    for (unsigned k = 0; k < frames; k++) {
+        seed = seed*1664525 + 1013904223;
+        float noise = (seed >> 8) / 16777216.0f - 0.5f, tone = 0.3f*sin(0.05*k);
+        signal[2*k] = 0.5f*noise + tone;
+        signal[2*k+1] = 0.3f*noise - 0.5f*tone;
+    }
+    return signal;
+}
+
+// time decoding one block with each of the given decoders, in microseconds; the decoders take turns, so that
+// they see the same conditions on a busy machine (the input is the test signal, unless one of 8 blocks is given)
+void time_decode(std::vector<freesurround_decoder*> decoders, channel_setup setup, unsigned N, double *result,
+                 std::vector<float> input = std::vector<float>()) {
+    const unsigned blocks = 8;
+    if (input.empty())
+        input = test_signal(blocks*N);
+    std::vector<float> output(blocks*N*freesurround_decoder::num_channels(setup));
+    for (unsigned d = 0; d < decoders.size(); d++)
+        result[d] = 1e30;
+    for (unsigned round = 0; round < 10; round++)
+        for (unsigned d = 0; d < decoders.size(); d++)
+            result[d] = std::min(result[d], time_us([&]() { decoders[d]->decode_many(&input[0], blocks*N, &output[0]); }, 50) / blocks);
+}
+
+// compare the decoders specialized for the common channel setups with the generic one
+bool bench_setups(sample_precision precision, unsigned N) {
+    static const struct { channel_setup setup; const char *name; } setups[] = {
+        {cs_stereo, "stereo"}, {cs_3stereo, "3stereo"}, {cs_4point1, "4.1"}, {cs_5point1, "5.1"}, {cs_7point1, "7.1"}
+    };
+    printf("Channel setups, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%10s%12s%12s%10s%12s\n", "setup", "specialized", "generic", "speedup", "output");
+    bool ok = true;
+    for (auto &s : setups) {
+        freesurround_decoder specialized(s.setup, N, precision);
+        freesurround_decoder *generic = freesurround_decoder::create_generic(s.setup, N, precision);
+        specialized.bass_redirection(true);
+        generic->bass_redirection(true);
+        double t[2];
+        time_decode({&specialized, generic}, s.setup, N, t);
+        const unsigned C = freesurround_decoder::num_channels(s.setup), frames = 16*N;
+        std::vector<float> input = test_signal(frames), output[2];
+        freesurround_decoder *decoders[2] = {&specialized, generic};
+        for (unsigned i = 0; i < 2; i++) {
+            output[i].resize(frames*C);
+            decoders[i]->flush();
+            decoders[i]->decode_many(&input[0], frames, &output[i][0]);
+        }
+        ok = ok && output[0] == output[1];
+        printf("%10s%12.1f%12.1f%9.2fx%12s\n", s.name, t[0], t[1], t[1]/t[0],
+               output[0] == output[1] ? "identical" : "DIFFERENT");
+        delete generic;
+    }
+    printf("\n");
+    return ok;
+}
+
+// latency and cost of the supported overlaps
+void bench_overlap(sample_precision precision, unsigned N) {
+    printf("Overlap, 5.1, %s, N=%u\n", precision == sp_float ? "float" : "double", N);
+    printf("%6s%8s%10s%12s%16s%8s\n", "hops", "overlap", "latency", "ms@48kHz", "us per block", "cost");
+    std::vector<freesurround_decoder*> decoders;
+    const unsigned hops[] = {2, 4, 8};
+    for (unsigned h : hops) {
+        decoders.push_back(new freesurround_decoder(cs_5point1, N, precision));
+        decoders.back()->overlap(h);
+    }
+    double t[3];
+    time_decode(decoders, cs_5point1, N, t);
+    for (unsigned i = 0; i < 3; i++) {
+        unsigned latency = N - N/hops[i];
+        printf("%6u%7.1f%%%10u%12.1f%16.1f%7.2fx\n", hops[i], 100.0*latency/N, latency, latency/48.0, t[i], t[i]/t[0]);
+        delete decoders[i];
+    }
+    printf("\n");
+}
+
+// measure the end-to-end latency of each processing mode with an impulse, fed in one hop at a time as a live
+// system would (so that the caller's buffering of one hop adds to the decoder's latency)
+void bench_latency(unsigned N) {
+    static const struct { const char *name; unsigned overlap, hop; } modes[] = {
+        {"50% overlap", 2, 0}, {"75% overlap", 4, 0}, {"87.5% overlap", 8, 0},
+        {"low latency", 0, 256}, {"low latency", 0, 128}, {"low latency", 0, 64}
+    };
+    printf("Latency, 5.1, N=%u: samples (impulse response peak, and end-to-end with one hop of buffering)\n", N);
+    printf("%14s%6s%10s%10s%12s%10s%16s\n", "mode", "hop", "latency()", "impulse", "end-to-end", "ms@48kHz", "us per block");
+    for (auto &m : modes) {
+        freesurround_decoder decoder(cs_5point1, N);
+        if (m.overlap)
+            decoder.overlap(m.overlap);
+        else
+            decoder.low_latency(m.hop);
+        unsigned hop = m.overlap ? N/m.overlap : m.hop, C = freesurround_decoder::num_channels(cs_5point1);
+        // a centered impulse, some blocks in
+        const unsigned frames = 8*N, at = 3*N + 17;
+        std::vector<float> input(2*frames), output(frames*C);
+        input[2*at] = input[2*at+1] = 1;
+        for (unsigned p = 0; p < frames; p += hop)
+            decoder.decode_many(&input[2*p], hop, &output[p*C]);
+        unsigned peak = 0;
+        float peak_value = 0;
+        for (unsigned k = 0; k < frames; k++) {
+            float sum = 0;
+            for (unsigned c = 0; c < C; c++)
+                sum += fabs(output[k*C+c]);
+            if (sum > peak_value) {
+                peak_value = sum;
+                peak = k;
+            }
+        }
+        double t;
+        time_decode({&decoder}, cs_5point1, N, &t);
+        printf("%14s%6u%10u%10d%12d%10.1f%16.1f\n", m.name, hop, decoder.latency(), (int)(peak-at), (int)(peak-at+hop),
+            (peak-at+hop)/48.0, t);
+    }
+    printf("\n");
+}
+
+// the deviation of an output from a reference, in dB (-999: identical)
+double deviation(const std::vector<float> &output, const std::vector<float> &reference) {
+    double signal = 0, noise = 0;
+    for (unsigned k = 0; k < reference.size(); k++) {
+        signal += reference[k]*reference[k];
+        noise += (output[k] - reference[k])*(output[k] - reference[k]);
+    }
+    return noise ? 10*log10(noise/signal) : -999.0;
+}
+
+// cost of silent and mono input with and without the shortcuts for them, and the deviation of the shortcut output
+void bench_paths(sample_precision precision, unsigned N) {
+    printf("Silent & mono shortcuts, 5.1, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%10s%12s%12s%10s%14s%14s\n", "input", "shortcut", "full", "speedup", "hops taken", "deviation dB");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1), frames = 8*N;
+    for (unsigned kind = 0; kind < 3; kind++) {
+        std::vector<float> input = test_signal(frames), output[2];
+        for (unsigned k = 0; k < frames; k++)
+            if (kind == 1)
+                input[2*k] = input[2*k+1] = 0;
+            else if (kind == 2)
+                input[2*k+1] = input[2*k];
+        freesurround_decoder shortcut(cs_5point1, N, precision), full(cs_5point1, N, precision);
+        full.silence_threshold(-1);
+        freesurround_decoder *decoders[] = {&shortcut, &full};
+        for (unsigned d = 0; d < 2; d++) {
+            output[d].resize(frames*C);
+            decoders[d]->decode_many(&input[0], frames, &output[d][0]);
+        }
+        size_t taken = shortcut.hop_count(hp_silent) + shortcut.hop_count(hp_mono), total = taken + shortcut.hop_count(hp_full);
+        double t[2] = {1e30, 1e30};
+        for (unsigned round = 0; round < 5; round++)
+            for (unsigned d = 0; d < 2; d++)
+                t[d] = std::min(t[d], time_us([&]() { decoders[d]->decode_many(&input[0], frames, &output[d][0]); }, 50) / 8);
+        printf("%10s%12.1f%12.1f%9.2fx%8zu/%-5zu%14.1f\n", kind == 0 ? "stereo" : kind == 1 ? "silent" : "mono", t[0], t[1],
+            t[1]/t[0], taken, total, deviation(output[0], output[1]));
+    }
+    printf("\n");
+}
+
+// a few tones panned across the stage, as a stationary test input
+std::vector<float> panned_tones(unsigned frames) {
+    std::vector<float> signal(2*frames);
+    for (unsigned k = 0; k < frames; k++)
+        for (unsigned i = 0; i < 6; i++) {
+            float tone = 0.1f*sin(0.013*pow(2.2, i)*k), pan = 0.2f*i;
+            signal[2*k] += tone*cos(pan*M_PI/2);
+            signal[2*k+1] += tone*sin(pan*M_PI/2);
+        }
+    return signal;
+}
+
+// accuracy of sp_float: the signal-to-noise ratio of its output against that of sp_double, for a range of setups and
+// soundfield settings, on decorrelated noise and on panned tones (two of which are present in one input channel only;
+// in single precision the other channel picks up rounding noise there, which moves those bins off the edge of the
+// soundfield)
+void bench_precision(unsigned N) {
+    printf("Precision, N=%u: SNR of sp_float against sp_double, in dB\n", N);
+    printf("%28s%10s%10s\n", "setup", "noise", "tones");
+    static const struct {
+        const char *name;
+        channel_setup setup;
+        bool lfe;
+        float wrap, shift, depth, focus, front, rear;
+    } cases[] = {
+        {"5.1", cs_5point1, false, 90, 0, 1, 0, 1, 1},
+        {"5.1 + lfe", cs_5point1, true, 90, 0, 1, 0, 1, 1},
+        {"7.1 wrap/shift/depth/focus", cs_7point1, false, 120, 0.2f, 1.5f, 0.3f, 1, 1},
+        {"stereo focus -0.4", cs_stereo, false, 90, 0, 1, -0.4f, 1, 1},
+        {"legacy", cs_legacy, false, 90, 0, 1, 0, 1, 1},
+        {"4.1 separations 0.5/2", cs_4point1, false, 90, 0, 1, 0, 0.5f, 2},
+        {"3stereo wrap 200", cs_3stereo, false, 200, 0, 1, 0, 1, 1},
+        {"16.1", cs_16point1, false, 90, 0, 1, 0, 1, 1}
+    };
+    const unsigned frames = 64*N;
+    std::vector<float> inputs[2] = {test_signal(frames), panned_tones(frames)};
+    for (auto &c : cases) {
+        const unsigned C = freesurround_decoder::num_channels(c.setup);
+        printf("%28s", c.name);
+        for (auto &input : inputs) {
+            std::vector<float> output[2];
+            for (unsigned p = 0; p < 2; p++) {
+                freesurround_decoder decoder(c.setup, N, p ? sp_float : sp_double);
+                decoder.bass_redirection(c.lfe);
+                decoder.circular_wrap(c.wrap);
+                decoder.shift(c.shift);
+                decoder.depth(c.depth);
+                decoder.focus(c.focus);
+                decoder.front_separation(c.front);
+                decoder.rear_separation(c.rear);
+                output[p].resize(frames*C);
+                decoder.decode_many(&input[0], frames, &output[p][0]);
+            }
+            printf("%10.1f", -deviation(output[1], output[0]));
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+// cost of steering by perceptual bands, and the deviation of the output from per-bin steering, for the test signal
+// and for a few tones panned across the stage (on decorrelated noise, where per-bin steering scatters every bin,
+// banded steering deviates by ca. -4 dB at any number of bands)
+void bench_bands(sample_precision precision, unsigned N) {
+    printf("Steering bands, 5.1, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%8s%12s%10s%20s%20s\n", "bands", "us", "speedup", "deviation dB: test", "panned tones");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1), frames = 16*N;
+    const unsigned counts[] = {0, 64, 40, 24, 12};
+    std::vector<float> inputs[2] = {test_signal(frames), panned_tones(frames)};
+    std::vector<float> reference[2], output(frames*C);
+    std::vector<freesurround_decoder*> decoders;
+    for (unsigned n : counts) {
+        decoders.push_back(new freesurround_decoder(cs_5point1, N, precision));
+        decoders.back()->steering_bands(n);
+    }
+    double t[5];
+    time_decode(decoders, cs_5point1, N, t);
+    for (unsigned i = 0; i < 5; i++) {
+        double dev[2];
+        for (unsigned s = 0; s < 2; s++) {
+            decoders[i]->flush();
+            decoders[i]->decode_many(&inputs[s][0], frames, &output[0]);
+            if (!i)
+                reference[s] = output;
+            dev[s] = deviation(output, reference[s]);
+        }
+        printf("%8u%12.1f%9.2fx%20.1f%20.1f\n", decoders[i]->steering_bands(counts[i]), t[i], t[0]/t[i], dev[0], dev[1]);
+        delete decoders[i];
+    }
+    printf("\n");
+}
+
+// accuracy of the steering table: per resolution and soundfield setting, the largest position error against the
+// analytic path (see freesurround_decoder::steering_error()) and the deviation of the output from steering_resolution(0)
+void bench_steering_resolution(sample_precision precision, unsigned N) {
+    printf("Steering table, 5.1, %s, N=%u: max position error / deviation dB (panned tones)\n",
+           precision == sp_float ? "float" : "double", N);
+    static const struct { const char *name; float wrap, focus; } settings[] = {
+        {"default", 90, 0}, {"wrap 30", 30, 0}, {"wrap 200", 200, 0}, {"focus 0.5", 90, 0.5f}, {"focus 0.9", 90, 0.9f},
+        {"focus -0.9", 90, -0.9f}
+    };
+    const unsigned resolutions[] = {64, 128, 256, 512};
+    printf("%12s", "setting");
+    for (unsigned res : resolutions)
+        printf("%10u%8s", res, "dB");
+    printf("\n");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1), frames = 16*N;
+    std::vector<float> input = panned_tones(frames), reference(frames*C), output(frames*C);
+    for (auto &s : settings) {
+        freesurround_decoder decoder(cs_5point1, N, precision);
+        decoder.circular_wrap(s.wrap);
+        decoder.focus(s.focus);
+        decoder.decode_many(&input[0], frames, &reference[0]);
+        printf("%12s", s.name);
+        for (unsigned res : resolutions) {
+            decoder.steering_resolution(res);
+            decoder.flush();
+            decoder.decode_many(&input[0], frames, &output[0]);
+            printf("%10.4f%8.1f", decoder.steering_error(res), deviation(output, reference));
+        }
+        printf("\n");
+        decoder.steering_resolution(0);
+    }
+    printf("\n");
+}
+
+// cost of computing the steering only every few hops (or when the spectra change), the share of hops that reused
+// the positions, and the deviation of the output from steering every hop
+void bench_interval(sample_precision precision, unsigned N) {
+    printf("Steering interval, 5.1, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%8s%8s%10s%10s%20s%20s\n", "hops", "flux", "us", "speedup", "reused/dev dB: test", "panned tones");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1), frames = 16*N;
+    static const struct { unsigned hops; float flux; } modes[] = {{1, 0}, {2, 0}, {4, 0}, {8, 0}, {8, 0.3f}};
+    std::vector<float> inputs[2] = {test_signal(frames), panned_tones(frames)};
+    std::vector<float> reference[2], output(frames*C);
+    std::vector<freesurround_decoder*> decoders;
+    for (auto &m : modes) {
+        decoders.push_back(new freesurround_decoder(cs_5point1, N, precision));
+        decoders.back()->steering_interval(m.hops, m.flux);
+    }
+    double t[5];
+    time_decode(decoders, cs_5point1, N, t);
+    for (unsigned i = 0; i < 5; i++) {
+        char result[2][32];
+        for (unsigned s = 0; s < 2; s++) {
+            decoders[i]->flush();
+            size_t reused = decoders[i]->hop_count(hp_reused), total = reused + decoders[i]->hop_count(hp_full);
+            decoders[i]->decode_many(&inputs[s][0], frames, &output[0]);
+            reused = decoders[i]->hop_count(hp_reused) - reused;
+            total = decoders[i]->hop_count(hp_reused) + decoders[i]->hop_count(hp_full) - total;
+            if (!i)
+                reference[s] = output;
+            snprintf(result[s], sizeof(result[s]), "%3.0f%% %7.1f", 100.0*reused/total, deviation(output, reference[s]));
+        }
+        printf("%8u%8.2f%10.1f%9.2fx%20s%20s\n", modes[i].hops, modes[i].flux, t[i], t[0]/t[i], result[0], result[1]);
+        delete decoders[i];
+    }
+    printf("\n");
+}
+
+// cost per hop of decoding in calls of one hop each (as a live host does) against calls of many hops, in low-latency
+// mode, on silent input (where a hop costs little more than the data it moves): the input history is a ring, so
+// short calls copy no more input per hop than long ones (before, every call that was shorter than the history
+// shifted all of it, i.e. ca. 32 KB per hop at N=4096)
+void bench_calls(sample_precision precision, unsigned N) {
+    printf("Call sizes, 5.1, silence, %s, N=%u: microseconds per hop\n", precision == sp_float ? "float" : "double", N);
+    printf("%8s%16s%16s%10s\n", "hop", "1 hop/call", "64 hops/call", "ratio");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1);
+    for (unsigned hop : {64u, 128u, 256u, N/2}) {
+        freesurround_decoder decoder(cs_5point1, N, precision);
+        if (hop < N/2)
+            decoder.low_latency(hop);
+        const unsigned frames = 64*hop;
+        std::vector<float> input(2*frames), output(frames*C);
+        double single = 1e30, many = 1e30;
+        for (unsigned round = 0; round < 5; round++) {
+            single = std::min(single, time_us([&]() {
+                for (unsigned p = 0; p < frames; p += hop)
+                    decoder.decode_many(&input[2*p], hop, &output[p*C]);
+            }, 5) / 64);
+            many = std::min(many, time_us([&]() { decoder.decode_many(&input[0], frames, &output[0]); }, 5) / 64);
+        }
+        printf("%8u%16.2f%16.2f%10.2f\n", hop, single, many, single/many);
+    }
+    printf("\n");
+}
+
+// cost of skipping the inverse transforms of (next to) empty channels on material that is panned across the front
+// stage, and of rendering only a subset of the channels, with the deviation of the rendered channels from a full run
+void bench_sparse(sample_precision precision, unsigned N) {
+    printf("Sparse synthesis, 7.1, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%16s%12s%10s%16s\n", "channels", "us", "speedup", "deviation dB");
+    const unsigned C = freesurround_decoder::num_channels(cs_7point1), frames = 16*N;
+    static const struct { const char *name; float threshold; unsigned mask; } modes[] = {
+        {"all, no skip", -1, ~0u}, {"all", 1e-12f, ~0u}, {"front", 1e-12f, ci_front_left|ci_front_center|ci_front_right},
+        {"center only", 1e-12f, ci_front_center}};
+    std::vector<float> input = panned_tones(frames), reference, output(frames*C);
+    std::vector<freesurround_decoder*> decoders;
+    for (auto &m : modes) {
+        decoders.push_back(new freesurround_decoder(cs_7point1, N, precision));
+        decoders.back()->sparsity_threshold(m.threshold);
+        decoders.back()->channel_mask(m.mask);
+    }
+    double t[4];
+    time_decode(decoders, cs_7point1, N, t, std::vector<float>(input.begin(), input.begin() + 2*8*N));
+    for (unsigned i = 0; i < 4; i++) {
+        decoders[i]->flush();
+        decoders[i]->decode_many(&input[0], frames, &output[0]);
+        if (!i)
+            reference = output;
+        // (only the rendered channels are compared)
+        for (size_t k = 0; k < output.size(); k++)
+            if (!(freesurround_decoder::channel_at(cs_7point1, k % C) & modes[i].mask))
+                output[k] = reference[k];
+        printf("%16s%12.1f%9.2fx%16.1f\n", modes[i].name, t[i], t[0]/t[i], deviation(output, reference));
+        delete decoders[i];
+    }
+    printf("\n");
+}
+
+// cost of the LFE channel: off, synthesized through the decimated transform (cutoff below ca. 170 Hz at N=4096),
+// and through the full one (higher cutoff)
+void bench_lfe(sample_precision precision, unsigned N) {
+    printf("LFE synthesis, 5.1, %s, N=%u: microseconds per block\n", precision == sp_float ? "float" : "double", N);
+    printf("%12s%12s%12s\n", "lfe", "cutoff Hz", "us");
+    static const struct { bool on; float cutoff; } modes[] = {{false, 90}, {true, 90}, {true, 250}};
+    std::vector<freesurround_decoder*> decoders;
+    for (auto &m : modes) {
+        decoders.push_back(new freesurround_decoder(cs_5point1, N, precision));
+        decoders.back()->bass_redirection(m.on);
+        decoders.back()->low_cutoff(m.cutoff/2/22050);
+        decoders.back()->high_cutoff(m.cutoff/22050);
+    }
+    double t[3];
+    time_decode(decoders, cs_5point1, N, t);
+    for (unsigned i = 0; i < 3; i++) {
+        printf("%12s%12.0f%12.1f\n", modes[i].on ? "on" : "off", modes[i].cutoff, t[i]);
+        delete decoders[i];
+    }
+    printf("\n");
+}
+
+// aggregate cost of decoding as many streams as the multi-stream decoder holds (one per SIMD lane), with that decoder
+// and with one scalar decoder per stream (without the silence skipping, which the multi-stream decoder does not do),
+// and whether each stream's output is that of its own decoder; returns false if not
+bool bench_multi(sample_precision precision, unsigned N) {
+    const unsigned S = freesurround_multi_decoder::streams(precision), frames = 16*N;
+    printf("Multi-stream decoding, %u streams, %s, N=%u: microseconds per block of all streams\n", S,
+           precision == sp_float ? "float" : "double", N);
+    printf("%10s%16s%16s%10s%16s\n", "setup", "separate", "multi", "speedup", "output");
+    bool same = true;
+    static const struct { const char *name; channel_setup setup; } setups[] = {{"stereo", cs_stereo}, {"5.1", cs_5point1}};
+    for (auto &s : setups) {
+        const unsigned C = freesurround_decoder::num_channels(s.setup);
+        std::vector<std::vector<float>> inputs(S), outputs(S, std::vector<float>(frames*C)), reference(outputs);
+        std::vector<const float*> in(S);
+        std::vector<float*> out(S);
+        std::vector<freesurround_decoder*> decoders;
+        for (unsigned i = 0; i < S; i++) {
+            inputs[i] = i % 2 ? panned_tones(frames) : test_signal(frames);
+            in[i] = &inputs[i][0];
+            out[i] = &outputs[i][0];
+            decoders.push_back(new freesurround_decoder(s.setup, N, precision));
+            decoders[i]->silence_threshold(-1);
+            decoders[i]->fft_implementation("pow2");
+        }
+        freesurround_multi_decoder multi(s.setup, N, precision);
+        multi.fft_implementation("pow2");
+        double separate = 1e30, together = 1e30;
+        for (unsigned round = 0; round < 5; round++) {
+            separate = std::min(separate, time_us([&]() {
+                for (unsigned i = 0; i < S; i++)
+                    decoders[i]->decode_many(in[i], frames, out[i]);
+            }, 50) / 16);
+            together = std::min(together, time_us([&]() { multi.decode_many(&in[0], frames, &out[0]); }, 50) / 16);
+        }
+        // decode the same input from a flushed state both ways
+        multi.flush();
+        multi.decode_many(&in[0], frames, &out[0]);
+        double worst = -999;
+        for (unsigned i = 0; i < S; i++) {
+            decoders[i]->flush();
+            decoders[i]->decode_many(in[i], frames, &reference[i][0]);
+            if (outputs[i] != reference[i])
+                worst = std::max(worst, deviation(outputs[i], reference[i]));
+        }
+        char result[32] = "identical";
+        if (worst > -999)
+            snprintf(result, sizeof(result), "%.1f dB", worst);
+        same = same && worst == -999;
+        printf("%10s%16.1f%16.1f%9.2fx%16s\n", s.name, separate, together, separate/together, result);
+        for (auto *d : decoders)
+            delete d;
+    }
+    printf("\n");
+    return same;
+}
+
+// cost per block of 16.1 decoding with a pool of worker threads, against decoding in the calling thread, and whether
+// the output is the same (on a host with fewer cores than threads, this shows the cost of the joins)
+// (the quiet signal drives the steering into the denormal range, which the worker threads must flush like the
+// calling thread does)
+bool bench_threads(sample_precision precision, unsigned N) {
+    printf("Worker threads, 16.1, %s, N=%u (%u cores): microseconds per block\n", precision == sp_float ? "float" : "double",
+           N, std::thread::hardware_concurrency());
+    printf("%8s%8s%12s%10s%12s\n", "signal", "workers", "us", "speedup", "output");
+    const unsigned C = freesurround_decoder::num_channels(cs_16point1), frames = 16*N;
+    std::vector<float> inputs[2] = {test_signal(frames), test_signal(frames)}, reference, output(frames*C);
+    for (unsigned k = 0; k < frames; k++) {
+        inputs[1][2*k] *= 1e-20f;
+        inputs[1][2*k+1] *= 1e-36f;
+    }
+    bool ok = true;
+    for (unsigned i = 0; i < 2; i++) {
+        double base = 0;
+        for (unsigned workers : {0u, 1u, 3u, 7u}) {
+            freesurround_decoder decoder(cs_16point1, N, precision);
+            decoder.bass_redirection(true);
+            decoder.worker_threads(workers);
+            double t = 1e30;
+            for (unsigned round = 0; round < 5; round++) {
+                decoder.flush();
+                t = std::min(t, time_us([&]() { decoder.decode_many(&inputs[i][0], frames, &output[0]); }, 50) / 16);
+            }
+            decoder.flush();
+            decoder.decode_many(&inputs[i][0], frames, &output[0]);
+            if (!workers) {
+                reference = output;
+                base = t;
+            }
+            ok = ok && output == reference;
+            printf("%8s%8u%12.1f%9.2fx%12s\n", i ? "quiet" : "normal", workers, t, base/t,
+                   output == reference ? "identical" : "DIFFERENT");
+        }
+    }
+    printf("\n");
+    return ok;
+}
+
+// heap memory taken by the first decoder of a kind, and by each further one (which shares the windows, transforms and
+// channel tables of the first), against the size of the arena that holds its own buffers
+void bench_memory(sample_precision precision, unsigned N) {
+    printf("Memory, %s, N=%u: KB per decoder\n", precision == sp_float ? "float" : "double", N);
+    printf("%10s%12s%12s%12s\n", "setup", "first", "further", "arena");
+    static const struct { channel_setup setup; const char *name; } setups[] = {
+        {cs_stereo, "stereo"}, {cs_5point1, "5.1"}, {cs_7point1, "7.1"}, {cs_16point1, "16.1"}
+    };
+    const unsigned count = 32;
+    // (large blocks are mapped rather than taken from the heap)
+    auto in_use = []() { struct mallinfo2 m = mallinfo2(); return m.uordblks + m.hblkhd; };
+    for (auto &s : setups) {
+        size_t before = in_use();
+        freesurround_decoder *first = new freesurround_decoder(s.setup, N, precision);
+        size_t after_first = in_use();
+        std::vector<freesurround_decoder*> more;
+        for (unsigned i = 0; i < count; i++)
+            more.push_back(new freesurround_decoder(s.setup, N, precision));
+        size_t after_more = in_use();
+        printf("%10s%12.1f%12.1f%12.1f\n", s.name, (after_first - before)/1024.0, (after_more - after_first)/1024.0/count,
+               freesurround_decoder::memory_footprint(s.setup, N, precision)/1024.0);
+        for (auto *d : more)
+            delete d;
+        delete first;
+    }
+    printf("\n");
+}
+
+// decode a tone hop by hop while another thread keeps changing the parameters, and compare the time per hop and the
+// largest step between consecutive output samples (a click would show up there) with those of an undisturbed run
+void bench_retune(unsigned N) {
+    printf("Live retuning, 5.1, N=%u, one hop per call\n", N);
+    printf("%12s%12s%12s%16s\n", "control", "changes", "us/hop", "largest step");
+    const unsigned C = freesurround_decoder::num_channels(cs_5point1), frames = 64*N, hop = N/2;
+    std::vector<float> input(2*frames), output(frames*C);
+    for (unsigned k = 0; k < frames; k++) {
+        input[2*k] = 0.5f*sin(0.01*k);
+        input[2*k+1] = 0.3f*sin(0.01*k + 0.5);
+    }
+    for (unsigned retune = 0; retune < 2; retune++) {
+        freesurround_decoder decoder(cs_5point1, N);
+        decoder.bass_redirection(true);
+        std::atomic<bool> done(false);
+        unsigned changes = 0;
+        std::thread control([&]() {
+            for (unsigned k = 0; retune && !done; k++, changes++) {
+                float v = (k % 7) / 6.0f;
+                decoder.shift(v - 0.5f);
+                decoder.focus(v - 0.5f);
+                decoder.center_image(1 - v);
+                decoder.front_separation(0.5f + v);
+                decoder.high_cutoff((60 + 60*v)/22050);
+                decoder.bass_redirection(k % 2);
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        });
+        double total = 0;
+        for (unsigned p = 0; p < frames; p += hop) {
+            auto t0 = std::chrono::steady_clock::now();
+            decoder.decode_many(&input[2*p], hop, &output[p*C]);
+            total += std::chrono::duration<double,std::micro>(std::chrono::steady_clock::now() - t0).count();
+        }
+        done = true;
+        control.join();
+        float step = 0;
+        for (unsigned k = N; k < frames; k++)
+            for (unsigned c = 0; c < C; c++)
+                step = std::max(step, fabsf(output[k*C+c] - output[(k-1)*C+c]));
+        printf("%12s%12u%12.1f%16.4f\n", retune ? "retuning" : "none", changes, total/(frames/hop), step);
+    }
+    printf("\n");
+}
+
+int main(int argc, const char *argv[]) {
+    std::string what = argc > 1 ? argv[1] : "all";
+    bool ok = true;
+    if (what == "all" || what == "fft") {
+        ok = bench_fft<double>("double") && ok;
+        ok = bench_fft<float>("float") && ok;
+    }
+    if (what == "all" || what == "precision")
+        bench_precision(4096);
+    if (what == "all" || what == "setups") {
+        ok = bench_setups(sp_double, 4096) && ok;
+        ok = bench_setups(sp_float, 4096) && ok;
+    }
+    if (what == "all" || what == "overlap") {
+        bench_overlap(sp_double, 4096);
+        bench_overlap(sp_float, 2048);
+    }
+    if (what == "all" || what == "latency")
+        bench_latency(2048);
+    if (what == "all" || what == "paths") {
+        bench_paths(sp_double, 4096);
+        bench_paths(sp_float, 4096);
+    }
+    if (what == "all" || what == "bands") {
+        bench_bands(sp_double, 4096);
+        bench_bands(sp_float, 4096);
+    }
+    if (what == "all" || what == "steering_resolution") {
+        bench_steering_resolution(sp_double, 4096);
+        bench_steering_resolution(sp_float, 4096);
+    }
+    if (what == "all" || what == "interval") {
+        bench_interval(sp_double, 4096);
+        bench_interval(sp_float, 4096);
+    }
+    if (what == "all" || what == "calls") {
+        bench_calls(sp_double, 4096);
+        bench_calls(sp_float, 4096);
+    }
+    if (what == "all" || what == "sparse") {
+        bench_sparse(sp_double, 4096);
+        bench_sparse(sp_float, 4096);
+    }
+    if (what == "all" || what == "lfe") {
+        bench_lfe(sp_double, 4096);
+        bench_lfe(sp_float, 4096);
+    }
+    if (what == "all" || what == "multi") {
+        ok = bench_multi(sp_double, 4096) && ok;
+        ok = bench_multi(sp_float, 4096) && ok;
+    }
+    if (what == "all" || what == "threads") {
+        ok = bench_threads(sp_double, 8192) && ok;
+        ok = bench_threads(sp_float, 8192) && ok;
+    }
+    if (what == "all" || what == "memory") {
+        bench_memory(sp_double, 4096);
+        bench_memory(sp_float, 4096);
+    }
+    if (what == "all" || what == "retune")
+        bench_retune(4096);
+    return ok ? 0 : 1;
+}
@@ -97,10 +97,19 @@ struct freesurround_params
     int srate;
     bool use_lfe;
     channel_setup channels_fs;		// FreeSurround channel setup
+    sample_precision precision;		// FreeSurround processing precision
+    unsigned overlap;				// FreeSurround hops per block
+    unsigned low_latency_hop;		// FreeSurround low-latency hop size (0 = off)
+    unsigned steering_bands;		// FreeSurround steering bands (0 = per bin)
+    unsigned steering_interval;		// FreeSurround hops between steered ones
+    float steering_flux;			// FreeSurround spectral flux that forces steering (0 = none)
+    unsigned channel_mask;			// FreeSurround channels that are rendered (the others are muted)
+    unsigned worker_threads;		// FreeSurround worker threads besides the decoding one
 
     // construct with defaults
     freesurround_params(): center_image(0.7), shift(0), depth(1), circular_wrap(90), focus(0), front_sep(1), rear_sep(1),
-        bass_lo(40), bass_hi(90), use_lfe(false), channels_fs(cs_5point1), srate(48000) {}
+        bass_lo(40), bass_hi(90), use_lfe(false), channels_fs(cs_5point1), srate(48000), precision(sp_double), overlap(2), low_latency_hop(0), steering_bands(0),
+        steering_interval(1), steering_flux(0), channel_mask(~0u), worker_threads(0) {}
 
     freesurround_params(float center_init,
                         float shift_init,
@@ -113,7 +122,15 @@ struct freesurround_params
                         float bass_hi_init,
                         bool use_lfe_init,
                         channel_setup cs_init,
-                        int srate_init):
+                        int srate_init,
+                        sample_precision precision_init = sp_double,
+                        unsigned overlap_init = 2,
+                        unsigned low_latency_hop_init = 0,
+                        unsigned steering_bands_init = 0,
+                        unsigned steering_interval_init = 1,
+                        float steering_flux_init = 0,
+                        unsigned channel_mask_init = ~0u,
+                        unsigned worker_threads_init = 0):
                             center_image(center_init),
                             shift(shift_init),
                             depth(depth_init),
@@ -125,18 +142,28 @@ struct freesurround_params
                             bass_hi(bass_hi_init),
                             use_lfe(use_lfe_init),
                             channels_fs(cs_init),
-                            srate (srate_init) {}
+                            srate (srate_init),
+                            precision(precision_init),
+                            overlap(overlap_init),
+                            low_latency_hop(low_latency_hop_init),
+                            steering_bands(steering_bands_init),
+                            steering_interval(steering_interval_init),
+                            steering_flux(steering_flux_init),
+                            channel_mask(channel_mask_init),
+                            worker_threads(worker_threads_init) {}
 };
 
 // the FreeSurround wrapper class
 class freesurround_wrapper {
-    enum { chunk_size = 2048 };
+    enum { block_size = 2048 };
 public:
     // construct the wrapper instance from a preset
     freesurround_wrapper(freesurround_params fs_params = freesurround_params()):
         params(fs_params),
+        // in low-latency mode, the decoder is fed one hop at a time
+        chunk_size(params.low_latency_hop ? params.low_latency_hop : block_size),
         rechunker(boost::bind(&freesurround_wrapper::process_chunk,this,_1),chunk_size*2),
-        decoder(params.channels_fs,2048), srate(params.srate)
+        decoder(params.channels_fs,block_size,params.precision), srate(params.srate)
     {
         // set up decoder parameters according to preset params
         decoder.circular_wrap(params.circular_wrap);
@@ -149,8 +176,16 @@ public:
         decoder.bass_redirection(params.use_lfe);
         decoder.low_cutoff(params.bass_lo/(srate/2.0));
         decoder.high_cutoff(params.bass_hi/(srate/2.0));
+        decoder.overlap(params.overlap);
+        if (params.low_latency_hop)
+            decoder.low_latency(params.low_latency_hop);
+        decoder.steering_bands(params.steering_bands);
+        decoder.steering_interval(params.steering_interval, params.steering_flux);
+        decoder.channel_mask(params.channel_mask);
+        decoder.worker_threads(params.worker_threads);
         rechunker.flush();
-        channel_map = fs_to_alsa(num_channels());
+        std::vector<int> alsa_map = fs_to_alsa(num_channels());
+        channel_map.assign(alsa_map.begin(), alsa_map.end());
     }
 
     // receive a chunk and buffer it
@@ -170,29 +205,29 @@ public:
     unsigned num_channels() {
         return decoder.num_channels(params.channels_fs);
     }
+
+    // number of hops the decoder processed along the given path
+    size_t hop_count(hop_path path) {
+        return decoder.hop_count(path);
+    }
+
     // process and emit a chunk (called by the rechunker when it's time)
     void process_chunk(float *stereo) {
-        // set sampling rate dependent parameters
-        decoder.low_cutoff(params.bass_lo/(srate/2.0));
-        decoder.high_cutoff(params.bass_hi/(srate/2.0));
-        // decode original chunk into discrete multichannel
-        float *src = decoder.decode(stereo);
-        // copy the data into the output chunk (respecting the different channel orders in alsa and FS)
-        unsigned channels = num_channels();
-        for (unsigned s=0; s<chunk_size; s++){
-            for (unsigned c=0; c<channels; c++) {
-                out_buf.push_back(src[channel_map[c]+(s*channels)]);
-            }
-        }
+        // decode original chunk into discrete multichannel, straight into the output buffer
+        // (in alsa channel order, which the decoder applies while writing)
+        size_t offset = out_buf.size();
+        out_buf.resize(offset + chunk_size*num_channels());
+        decoder.decode_many(stereo, chunk_size, &out_buf[offset], &channel_map[0]);
     }
 
 private:
     freesurround_params params;			// parameters
+    unsigned chunk_size;				// stereo samples per chunk passed to the decoder
     stream_chunker<float> rechunker;	// gathers/splits the inbound data stream into equally-sized chunks
     freesurround_decoder decoder;		// the surround decoder
     unsigned srate;	             		// last known sampling rate
     std::vector<float> out_buf;			// the buffer where we store outgoing samples
-    std::vector<int> channel_map;
+    std::vector<unsigned> channel_map;	// decoder channel at each position of an alsa frame
 };
 
 //Threaded input
@@ -388,6 +423,77 @@ argparse::ArgumentParser make_parser() {
         .nargs(1)
         .action([](const std::string& value) {return std::stof(value);});
 
+    parser.add_argument("--precision")
+        .help("The precision of the decoder's internal processing. Choose from double or float.")
+        .default_value(std::string{"double"})
+        .nargs(1)
+        .action([](const std::string& value) {
+            static const std::vector<std::string> choices = {"double","float"};
+            if (std::find(choices.begin(),choices.end(),value)!=choices.end()) {
+                return value;
+            }
+            return std::string{"double"};
+        });
+
+    parser.add_argument("--overlap")
+        .help("Hops per block: 2 (50% overlap), 4 (75%) or 8 (87.5%). Higher is smoother and slower, and adds latency.")
+        .default_value(2)
+        .nargs(1)
+        .action([](const std::string& value) {
+            int hops = std::stoi(value);
+            return hops == 4 || hops == 8 ? hops : 2;
+        });
+
+    parser.add_argument("--low_latency")
+        .help("Low-latency mode with the given hop size in samples (64 to 1024, a power of two), for live use. [default: off]")
+        .default_value(0)
+        .nargs(1)
+        .action([](const std::string& value) {
+            int hop = std::stoi(value);
+            return hop >= 64 && hop <= 1024 && !(hop & (hop-1)) ? hop : 0;
+        });
+
+    parser.add_argument("--steering_interval")
+        .help("Compute the steering only every this many hops (1 to 16), reusing it in between. Cheaper on stationary material.")
+        .default_value(1)
+        .nargs(1)
+        .action([](const std::string& value) {
+            int hops = std::stoi(value);
+            return hops >= 1 && hops <= 16 ? hops : 1;
+        });
+
+    parser.add_argument("--steering_flux")
+        .help("With --steering_interval: steer anyway once the spectrum has changed by more than this fraction (e.g. 0.3); 0 for a fixed interval.")
+        .default_value(0.0)
+        .nargs(1)
+        .action([](const std::string& value) {
+            double flux = std::stod(value);
+            return flux > 0 ? flux : 0.0;
+        });
+
+    parser.add_argument("--bands")
+        .help("Steer by this many perceptual bands (24 to 64) instead of by frequency bins, which is cheaper; 0 to steer by bins, for A/B comparison.")
+        .default_value(0)
+        .nargs(1)
+        .action([](const std::string& value) {
+            int bands = std::stoi(value);
+            return bands > 0 ? std::min(bands, 256) : 0;
+        });
+
+    parser.add_argument("--threads")
+        .help("Share the decoding of each block with this many worker threads (0 to 16); only worth it for wide setups on idle cores.")
+        .default_value(0)
+        .nargs(1)
+        .action([](const std::string& value) {
+            int threads = std::stoi(value);
+            return threads > 0 ? std::min(threads, 16) : 0;
+        });
+
+    parser.add_argument("--center_only")
+        .help("Render only the center channel (dialog extraction); the other channels are written as silence.")
+        .default_value(false)
+        .implicit_value(true);
+
     return parser;
 }
 
@@ -435,6 +541,14 @@ int main(int argc, const char *argv[]) {
     float bass_lo = parser.get<double>("--bass_lo");
     float bass_hi = parser.get<double>("--bass_hi");
     bool use_lfe = parser.get<bool>("--use_lfe");
+    std::string precision = parser.get<std::string>("--precision");
+    int overlap = parser.get<int>("--overlap");
+    int low_latency = parser.get<int>("--low_latency");
+    int bands = parser.get<int>("--bands");
+    int steering_interval = parser.get<int>("--steering_interval");
+    float steering_flux = parser.get<double>("--steering_flux");
+    bool center_only = parser.get<bool>("--center_only");
+    int threads = parser.get<int>("--threads");
 
     // set up fsdecode data
     threaded_circ_buffer<float> *in_buf = new threaded_circ_buffer<float>;
@@ -470,7 +584,8 @@ int main(int argc, const char *argv[]) {
     channel_setup cs = choices[channels-1];
     freesurround_wrapper *wrapper = new freesurround_wrapper(freesurround_params(
         center_image, shift, depth, circular_wrap, focus, front_sep, rear_sep,
-        bass_lo, bass_hi, use_lfe, cs, samplerate));
+        bass_lo, bass_hi, use_lfe, cs, samplerate, precision == "float" ? sp_float : sp_double, overlap, low_latency, bands,
+        steering_interval, steering_flux, center_only ? ci_front_center : ~0u, threads));
 
     // log verbose output
     if (verbose) {
@@ -491,6 +606,13 @@ int main(int argc, const char *argv[]) {
         std::cerr << "\tBass Low Cutoff: " << bass_lo << std::endl;
         std::cerr << "\tBass High Cutoff: " << bass_hi << std::endl;
         std::cerr << "\tUse LFE: " << use_lfe << std::endl;
+        std::cerr << "\tPrecision: " << precision << std::endl;
+        std::cerr << "\tOverlap: " << overlap << " hops per block" << std::endl;
+        std::cerr << "\tLow latency hop: " << low_latency << std::endl;
+        std::cerr << "\tSteering bands: " << bands << std::endl;
+        std::cerr << "\tSteering interval: " << steering_interval << " hops, flux " << steering_flux << std::endl;
+        std::cerr << "\tCenter only: " << center_only << std::endl;
+        std::cerr << "\tWorker threads: " << threads << std::endl;
     }
 
     std::thread thread_in;
@@ -512,6 +634,15 @@ int main(int argc, const char *argv[]) {
     thread_decode.join();
     if (output == "stdout") {thread_out.join();}
 
+    // log decoder statistics
+    if (verbose) {
+        std::cerr << "Decoder statistics (hops)" << std::endl;
+        std::cerr << "\tSteered: " << wrapper->hop_count(hp_full) << std::endl;
+        std::cerr << "\tReused steering: " << wrapper->hop_count(hp_reused) << std::endl;
+        std::cerr << "\tSilent: " << wrapper->hop_count(hp_silent) << std::endl;
+        std::cerr << "\tMono: " << wrapper->hop_count(hp_mono) << std::endl;
+    }
+
     // If output is a file, copy the output buffer to that file
     if (output != "stdout") {
         AudioFile<float> out_file;